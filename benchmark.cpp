@@ -0,0 +1,163 @@
+#include <ensemble.hpp>
+#include <deposition.hpp>
+#include <statdata.hpp>
+#include <chrono>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <functional>
+
+// Benchmarks of the deposition kernels, measurements, statistics and ensembles.
+// Usage: benchmark [output.json] [--baseline baseline.json] [--tolerance 0.1]
+// Every result is a rate (higher is better), so it can be compared against a stored baseline.
+
+typedef std::chrono::steady_clock Clock;
+
+// Run the function repeatedly for at least the minimum time. Returns seconds per call.
+double timeit(const std::function<void()>& function, double minimum = 0.25) {
+	unsigned calls = 0;
+	auto begin = Clock::now();
+	double elapsed = 0;
+
+	do {
+		function();
+		++calls;
+		elapsed = std::chrono::duration<double>(Clock::now() - begin).count();
+	} while (elapsed < minimum);
+
+	return elapsed / calls;
+}
+
+// Depositions per second of a kernel on a lattice of the given size.
+double depositionRate(unsigned size, std::function<void(Surface<int>&, int)> method) {
+	Surface<int> surface(size);
+	unsigned depositions = std::max(size, 100000u);
+	return depositions / timeit([&]() {method(surface, depositions);});
+}
+
+// Bytes of the grid scanned per second by Surface::surfaceData().
+double momentScanRate(unsigned size) {
+	Surface<int> surface(size);
+	randomDeposition(surface, 10 * size);
+
+	volatile float sink = 0;
+	double seconds = timeit([&]() {sink = sink + surface.surfaceData<float>().width();});
+	return 2.0 * size * sizeof(int) / seconds;
+}
+
+// StatisticalData::newData(const SurfaceData&) calls per second.
+double statisticsRate() {
+	Surface<int> surface(1000);
+	randomDeposition(surface, 10000);
+	SurfaceData<float> data = surface.surfaceData<float>();
+
+	StatisticalData<SurfaceData<float>, float> statistics;
+	const unsigned calls = 100000;
+	return calls / timeit([&]() {for (unsigned i = 0; i < calls; ++i) statistics.newData(data);});
+}
+
+// Random deposition with a generator per thread. The kernels in deposition.hpp share the
+// global gen, which is a data race when workers run them concurrently.
+void threadRandomDeposition(Surface<int>& surface, int depositions) {
+	thread_local std::mt19937 local(rd());
+	std::uniform_int_distribution<unsigned> dist(0, surface.size()-1);
+	for (int i = 0; i < depositions; ++i) ++surface[dist(local)];
+}
+
+// Systems per second of a whole ensemble run, repeated for the minimum time.
+template <unsigned systems>
+double ensembleRate(unsigned threads, unsigned size, float nltotal) {
+	return systems / timeit([&]() {
+		SurfaceGrowthEnsemble<int, float, systems> ensemble(size);
+		ensemble.multithreadDeposition(threads, size, nltotal, &threadRandomDeposition);
+	});
+}
+
+// Exports per second of SurfaceGrowthEnsemble::saveJson().
+double jsonRate(unsigned size, float nltotal) {
+	SurfaceGrowthEnsemble<int, float, 4> ensemble(size);
+	ensemble.deposition(size / 10, nltotal, &randomDeposition<int>);
+
+	std::string json;
+	return 1.0 / timeit([&]() {ensemble.saveJson(json);});
+}
+
+int main(int argc, char** argv) {
+	std::string output, baseline;
+	double tolerance = 0.1;
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--baseline" && i+1 < argc) baseline = argv[++i];
+		else if (arg == "--tolerance" && i+1 < argc) tolerance = std::stod(argv[++i]);
+		else output = arg;
+	}
+
+	Json::Value root;
+	unsigned hardware = std::max(std::thread::hardware_concurrency(), 1u);
+	root["machine"]["threads"] = hardware;
+
+	// Deposition kernels
+	for (unsigned size : {1000u, 100000u, 1000000u}) {
+		std::string sz = std::to_string(size);
+		root["deposition"]["random"][sz] = depositionRate(size, &randomDeposition<int>);
+		root["deposition"]["ballistic"][sz] = depositionRate(size, &ballisticDeposition2D<int>);
+	}
+
+	// Measurements and statistics
+	for (unsigned size : {100000u, 10000000u}) {
+		root["moment-scan"][std::to_string(size)] = momentScanRate(size);
+	}
+	root["statistics"]["newData"] = statisticsRate();
+
+	// Ensemble strong scaling: fixed number of systems, growing number of threads.
+	// Ensemble weak scaling: as many systems as threads.
+	for (unsigned threads = 1; threads <= std::min(hardware, 16u); threads *= 2) {
+		std::string th = std::to_string(threads);
+		root["ensemble"]["strong"][th] = ensembleRate<16>(threads, 10000, 20);
+		switch (threads) {
+			case 1: root["ensemble"]["weak"][th] = ensembleRate<1>(threads, 10000, 20); break;
+			case 2: root["ensemble"]["weak"][th] = ensembleRate<2>(threads, 10000, 20); break;
+			case 4: root["ensemble"]["weak"][th] = ensembleRate<4>(threads, 10000, 20); break;
+			case 8: root["ensemble"]["weak"][th] = ensembleRate<8>(threads, 10000, 20); break;
+			case 16: root["ensemble"]["weak"][th] = ensembleRate<16>(threads, 10000, 20); break;
+		}
+	}
+
+	// Output
+	root["json-export"]["1000"] = jsonRate(1000, 100);
+
+	Json::StreamWriterBuilder writer;
+	std::string json = Json::writeString(writer, root);
+	if (output.empty()) std::cout << json << std::endl;
+	else std::ofstream(output) << json << std::endl;
+
+	// Compare against the baseline
+	if (baseline.empty()) return 0;
+
+	Json::Value base;
+	std::ifstream file(baseline);
+	Json::CharReaderBuilder reader;
+	std::string errors;
+	if (!Json::parseFromStream(reader, file, &base, &errors)) {
+		std::cerr << "Could not read baseline: " << errors << std::endl;
+		return 2;
+	}
+
+	int regressions = 0;
+	std::function<void(const Json::Value&, const Json::Value&, const std::string&)> compare;
+	compare = [&](const Json::Value& current, const Json::Value& previous, const std::string& path) {
+		if (current.isObject()) {
+			for (const std::string& key : current.getMemberNames()) {
+				if (previous.isMember(key)) compare(current[key], previous[key], path + "/" + key);
+			}
+		} else if (current.isDouble() && previous.isNumeric() && path.find("/machine") != 0) {
+			double ratio = current.asDouble() / previous.asDouble();
+			bool regression = ratio < 1.0 - tolerance;
+			if (regression) ++regressions;
+			std::cerr << path << ": " << ratio << (regression ? "  REGRESSION" : "") << std::endl;
+		}
+	};
+	compare(root, base, "");
+
+	return regressions ? 1 : 0;
+}
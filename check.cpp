@@ -0,0 +1,189 @@
+#include <statdata.hpp>
+#include <surfacedata.hpp>
+#include <growth.hpp>
+#include <deposition.hpp>
+#include <cstdint>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <string>
+#include <iostream>
+
+// Checks of StatisticalData against a two-pass long double reference: one-pass updates and
+// merges for orders up to 4, raw moments rebuilt from the central ones, and the empty and
+// one-sample edge cases. Also checks that narrow height types grow exactly like int.
+// Usage: check. Exits with 1 if any check fails.
+
+unsigned failures = 0;
+
+// Compare a value with the reference, with a tolerance relative to the given scale.
+void expect(const std::string& name, long double value, long double reference, long double scale, long double tolerance) {
+	bool pass = std::abs(value - reference) <= tolerance * std::max<long double>(scale, 1e-300L);
+	if (!pass) {
+		++failures;
+		std::cout << "FAIL " << name << ": " << static_cast<double>(value) << " != " << static_cast<double>(reference) << std::endl;
+	}
+}
+
+// Two-pass central moment <(x - <x>)^p> and raw moment <x^p>.
+long double centralReference(const std::vector<double>& data, unsigned p) {
+	long double mean = 0, result = 0;
+	for (double x : data) mean += x;
+	mean /= data.size();
+	for (double x : data) result += std::pow(x - mean, static_cast<long double>(p));
+	return result / data.size();
+}
+
+long double rawReference(const std::vector<double>& data, unsigned p) {
+	long double result = 0;
+	for (double x : data) result += std::pow(static_cast<long double>(x), static_cast<long double>(p));
+	return result / data.size();
+}
+
+// Every central and raw moment of the accumulator against the reference.
+template <typename FloatingPoint, unsigned order>
+void compare(const std::string& name, const StatisticalData<FloatingPoint, FloatingPoint, order>& statistics,
+const std::vector<double>& data, long double tolerance) {
+	if (statistics.size() != data.size()) {
+		++failures;
+		std::cout << "FAIL " << name << ": size " << statistics.size() << " != " << data.size() << std::endl;
+	}
+
+	long double sigma = std::sqrt(centralReference(data, 2));
+	expect(name + " mean", statistics.average(), rawReference(data, 1), std::abs(rawReference(data, 1)) + sigma, tolerance);
+	for (unsigned p = 2; p <= order; ++p) {
+		long double scale = std::pow(sigma, static_cast<long double>(p));
+		expect(name + " central " + std::to_string(p), statistics.centralMoment(p), centralReference(data, p), scale, tolerance);
+		expect(name + " raw " + std::to_string(p), statistics.moment(p), rawReference(data, p), std::abs(rawReference(data, p)), tolerance);
+	}
+}
+
+// Skewed samples around a large offset, where raw power sums lose every digit.
+std::vector<double> samples(unsigned size, double offset, unsigned seed) {
+	std::mt19937 gen(seed);
+	std::gamma_distribution<double> dist(2.0, 1.5);
+	std::vector<double> result(size);
+	for (double& x : result) x = offset + dist(gen);
+	return result;
+}
+
+template <typename FloatingPoint, unsigned order>
+void checkOrder(const std::string& type, double offset, long double tolerance) {
+	std::string name = type + " order " + std::to_string(order) + " offset " + std::to_string(offset);
+	std::vector<double> data = samples(10000, offset, order);
+
+	// One-pass update
+	StatisticalData<FloatingPoint, FloatingPoint, order> single;
+	for (double x : data) single.newData(static_cast<FloatingPoint>(x));
+	compare(name + " update", single, data, tolerance);
+
+	// Merge of uneven parts, including an empty and a one-sample part
+	std::vector<unsigned> cuts = {0, 0, 1, 37, 2500, 2501, 7000, 10000};
+	StatisticalData<FloatingPoint, FloatingPoint, order> merged;
+	for (unsigned c = 0; c + 1 < cuts.size(); ++c) {
+		StatisticalData<FloatingPoint, FloatingPoint, order> part;
+		for (unsigned i = cuts[c]; i < cuts[c+1]; ++i) part.newData(static_cast<FloatingPoint>(data[i]));
+		merged.newData(part);
+	}
+	compare(name + " merge", merged, data, tolerance);
+}
+
+void checkEdges() {
+	// Empty accumulators, alone and merged
+	StatisticalData<double, double, 4> empty, other;
+	empty.newData(other);
+	expect("empty size", empty.size(), 0, 1, 0);
+	expect("empty mean", empty.average(), 0, 1, 0);
+	expect("empty variance", empty.variance(), 0, 1, 0);
+	expect("empty central 4", empty.centralMoment(4), 0, 1, 0);
+
+	// A single sample: every central moment vanishes, raw moments are powers of it
+	StatisticalData<double, double, 4> one;
+	one.newData(3.0);
+	expect("one mean", one.average(), 3, 3, 0);
+	expect("one variance", one.variance(), 0, 1, 0);
+	expect("one raw 4", one.moment(4), 81, 81, 1e-15L);
+
+	// Merges with empty and one-sample accumulators on either side
+	StatisticalData<double, double, 4> left = one;
+	left.newData(empty);
+	expect("one + empty mean", left.average(), 3, 3, 0);
+	expect("one + empty size", left.size(), 1, 1, 0);
+
+	StatisticalData<double, double, 4> right = empty;
+	right.newData(one);
+	expect("empty + one mean", right.average(), 3, 3, 0);
+
+	StatisticalData<double, double, 4> two = one;
+	StatisticalData<double, double, 4> five;
+	five.newData(5.0);
+	two.newData(five);
+	compare("one + one", two, std::vector<double>({3.0, 5.0}), 1e-15L);
+
+	// Clearing restarts from nothing
+	two.clear();
+	two.newData(7.0);
+	compare("clear", two, std::vector<double>({7.0}), 1e-15L);
+
+	// SurfaceData accumulates elementwise
+	StatisticalData<SurfaceData<double>, double, 3> surface;
+	std::vector<double> data = samples(1000, 50, 7);
+	for (double x : data) surface.newData(SurfaceData<double>({x, x*x, 0, 0}, {0, x, 0, 0}));
+	expect("SurfaceData mean", surface.average().height(), rawReference(data, 1), rawReference(data, 1), 1e-12L);
+	expect("SurfaceData central 3", surface.centralMoment(3).height(), centralReference(data, 3),
+		std::pow(std::sqrt(centralReference(data, 2)), 3.0L), 1e-9L);
+}
+
+// Grow the same ballistic deposition with two height types and compare the profiles.
+template <typename Narrow>
+void checkNarrow(const std::string& name, unsigned size, double nltotal) {
+	SurfaceGrowth<int, double> wide(size);
+	SurfaceGrowth<Narrow, double> narrow(size);
+	gen.seed(137);
+	wide.deposition(size, nltotal, &ballisticDeposition2D<int>);
+	gen.seed(137);
+	narrow.deposition(size, nltotal, &ballisticDeposition2D<Narrow>);
+
+	unsigned mismatches = 0;
+	for (unsigned i = 0; i < size; ++i) if (wide.height(i) != narrow.height(i)) ++mismatches;
+	expect(name + " profile mismatches", mismatches, 0, 1, 0);
+	expect(name + " width", narrow.dataValue(narrow.dataSize()-1).width(), wide.dataValue(wide.dataSize()-1).width(), 1, 0);
+}
+
+// A kernel written with plain operator[] increments must not overflow a narrow type.
+void uniformKernel(Surface<std::int8_t>& surface, int depositions) {
+	for (int i = 0; i < depositions; ++i) ++surface[i % surface.size()];
+}
+
+void checkOperator() {
+	SurfaceGrowth<std::int8_t, double> growth(10);
+	growth.deposition(10, 300, &uniformKernel);
+	for (unsigned i = 0; i < growth.size(); ++i) expect("operator[] height " + std::to_string(i), growth.height(i), 300, 300, 0);
+
+	SurfaceGrowth<std::uint64_t, double> wide(100);
+	wide.deposition(100, 10, &randomDeposition<std::uint64_t>);
+	expect("uint64 mean height", wide.dataValue(wide.dataSize()-1).height(), 10, 10, 1e-12L);
+}
+
+int main() {
+	checkOrder<double, 2>("double", 0, 1e-10L);
+	checkOrder<double, 3>("double", 0, 1e-10L);
+	checkOrder<double, 4>("double", 0, 1e-10L);
+	checkOrder<double, 3>("double", 1e6, 1e-6L);
+	checkOrder<double, 4>("double", 1e6, 1e-6L);
+	checkOrder<float, 2>("float", 0, 1e-3L);
+	checkOrder<float, 4>("float", 0, 1e-3L);
+	checkOrder<float, 4>("float", 100, 1e-2L);
+	checkEdges();
+	checkNarrow<std::int8_t>("int8", 1000, 2000);
+	checkNarrow<std::int16_t>("int16", 100000, 50);
+	checkOperator();
+
+	if (failures > 0) {
+		std::cout << failures << " check(s) failed" << std::endl;
+		return 1;
+	}
+
+	std::cout << "All checks passed" << std::endl;
+	return 0;
+}
@@ -0,0 +1,157 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <ostream>
+#include <thread>
+#ifdef __linux__
+#include <sched.h>
+#include <pthread.h>
+#endif
+
+// NUMA topology of the machine, read from /sys on Linux. Everywhere else, or when the
+// information is missing, the machine is seen as a single node holding every CPU.
+// Workers are spread round-robin over the nodes, so that each one runs, and first-touches
+// its memory, on its own node.
+class Topology {
+	// CPUs of each node, restricted to the ones this process may run on.
+	std::vector<std::vector<unsigned>> _nodes;
+
+	// Parse a cpulist like "0-3,8,10-11".
+	static std::vector<unsigned> parseList(const std::string& str);
+
+public:
+	// Constructor functions
+	Topology() {}
+	static Topology detect();
+
+	// Accessor functions
+	inline unsigned nodes() const {return _nodes.size();}
+	inline const std::vector<unsigned>& node(unsigned i) const {return _nodes[i];}
+	unsigned cpus() const;
+
+	// Placement of a worker
+	inline unsigned nodeOf(unsigned worker) const {return worker % _nodes.size();}
+	unsigned cpuOf(unsigned worker) const;
+
+	// Pin the calling thread to a CPU. Returns false if not supported or denied.
+	static bool pin(unsigned cpu);
+
+	// Human readable description of the nodes and of the planned placement of the workers.
+	void report(std::ostream& stream, unsigned workers) const;
+
+	// Line with the actual placement of a worker, once it tried to pin.
+	void report(std::ostream& stream, unsigned worker, bool pinned) const;
+};
+
+
+inline std::vector<unsigned> Topology::parseList(const std::string& str) {
+	std::vector<unsigned> result;
+	std::stringstream stream(str);
+	std::string range;
+
+	while (std::getline(stream, range, ',')) {
+		if (range.empty() || range == "\n") continue;
+		std::size_t dash = range.find('-');
+		unsigned from = std::stoul(range.substr(0, dash));
+		unsigned to = (dash == std::string::npos) ? from : std::stoul(range.substr(dash+1));
+		for (unsigned cpu = from; cpu <= to; ++cpu) result.push_back(cpu);
+	}
+
+	return result;
+}
+
+inline Topology Topology::detect() {
+	Topology topology;
+
+#ifdef __linux__
+	// CPUs this process may run on
+	cpu_set_t allowed;
+	CPU_ZERO(&allowed);
+	bool restricted = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+
+	// Online node IDs, which need not be contiguous. Without the list, probe from node0 up.
+	std::vector<unsigned> online;
+	std::ifstream list("/sys/devices/system/node/online");
+	std::string ids;
+	if (list && std::getline(list, ids)) online = parseList(ids);
+	bool listed = !online.empty();
+
+	for (unsigned i = 0; listed ? i < online.size() : true; ++i) {
+		unsigned n = listed ? online[i] : i;
+		std::ifstream file("/sys/devices/system/node/node" + std::to_string(n) + "/cpulist");
+		if (!file) {
+			if (listed) continue;
+			break;
+		}
+
+		std::string line;
+		std::getline(file, line);
+		std::vector<unsigned> cpus;
+		for (unsigned cpu : parseList(line)) {
+			if (!restricted || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed))) cpus.push_back(cpu);
+		}
+		if (!cpus.empty()) topology._nodes.push_back(cpus);
+	}
+
+	// No NUMA information: a single node with the allowed CPUs.
+	if (topology._nodes.empty() && restricted) {
+		std::vector<unsigned> cpus;
+		for (unsigned cpu = 0; cpu < CPU_SETSIZE; ++cpu) if (CPU_ISSET(cpu, &allowed)) cpus.push_back(cpu);
+		if (!cpus.empty()) topology._nodes.push_back(cpus);
+	}
+#endif
+
+	if (topology._nodes.empty()) {
+		std::vector<unsigned> cpus;
+		unsigned hardware = std::max(std::thread::hardware_concurrency(), 1u);
+		for (unsigned cpu = 0; cpu < hardware; ++cpu) cpus.push_back(cpu);
+		topology._nodes.push_back(cpus);
+	}
+
+	return topology;
+}
+
+inline unsigned Topology::cpus() const {
+	unsigned result = 0;
+	for (const std::vector<unsigned>& node : _nodes) result += node.size();
+	return result;
+}
+
+inline unsigned Topology::cpuOf(unsigned worker) const {
+	const std::vector<unsigned>& cpus = _nodes[nodeOf(worker)];
+	return cpus[(worker / _nodes.size()) % cpus.size()];
+}
+
+inline bool Topology::pin(unsigned cpu) {
+#ifdef __linux__
+	if (cpu >= CPU_SETSIZE) return false;
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+	return false;
+#endif
+}
+
+inline void Topology::report(std::ostream& stream, unsigned workers) const {
+	stream << "Topology: " << nodes() << " node(s), " << cpus() << " CPU(s)" << std::endl;
+	for (unsigned n = 0; n < nodes(); ++n) {
+		stream << "  node " << n << ":";
+		for (unsigned cpu : _nodes[n]) stream << " " << cpu;
+		stream << std::endl;
+	}
+
+	for (unsigned w = 0; w < workers; ++w) {
+		stream << "  worker " << w << " -> cpu " << cpuOf(w) << " (node " << nodeOf(w) << ")" << std::endl;
+	}
+}
+
+inline void Topology::report(std::ostream& stream, unsigned worker, bool pinned) const {
+	stream << "  worker " << worker << " -> cpu " << cpuOf(worker) << " (node " << nodeOf(worker) << ")";
+	if (!pinned) stream << ": pinning failed, running unpinned";
+	stream << std::endl;
+}
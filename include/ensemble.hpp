@@ -1,8 +1,19 @@
 #pragma once
 #include "growth.hpp"
 #include "statdata.hpp"
+#include "localwidth.hpp"
+#include "histogram.hpp"
+#include "snapshot.hpp"
+#include "affinity.hpp"
+#include "resampling.hpp"
+#include "job.hpp"
+#include <atomic>
+#include <future>
+#include <memory>
+#include <exception>
 #include <thread>
 #include <mutex>
+#include <iostream>
 #include <json/json.h>
 #include <json/writer.h>
 
@@ -16,19 +27,94 @@ class SurfaceGrowthEnsemble : private SurfaceGrowth<Integer, FloatingPoint> {
 	StatisticalData<SurfaceData<FloatingPoint>, FloatingPoint> _log_inclination;
 	StatisticalData<SurfaceData<FloatingPoint>, FloatingPoint> _log_independent;
 
+	// Optional multiscale local width, measured at every iteration
+	LocalWidth<FloatingPoint> _local_width;
+
+	// Optional distribution of the height fluctuations, measured at every iteration
+	HeightHistogram<FloatingPoint> _height_histogram;
+
+	// Optional resampling errors of the growth exponents, and the last computed result
+	ExponentResampling<FloatingPoint> _resampling;
+	std::vector<typename ExponentResampling<FloatingPoint>::Exponent> _exponents;
+	unsigned _resamples = 0, _seed = 0;
+
+	// Optional writer of profile snapshots at scheduled nl values
+	ProfileWriter* _snapshots = nullptr;
+
 	// Initial Surface to begin deposition
 	Surface<Integer> _surface;
 
+	// Memory resource of the grids, also used by the multithreaded workers
+	std::pmr::memory_resource* _resource;
+
+	// Pin the multithreaded workers to the CPUs of their NUMA nodes
+	bool _affinity = false;
+
+	// Guards the ensemble data while workers merge into it
+	mutable std::mutex _mutex;
+
+	// Time step of the current multithreaded run, for the nl of snapshots
+	FloatingPoint _step = FloatingPoint();
+
+	// Multithreaded deposition, reporting to and cancelled by the control
+	void run(unsigned threads, unsigned deposition_per_iteration, const FloatingPoint& nltotal,
+		const std::function<void(Surface<Integer>& surface,int)>& depositionMethod, JobControl& control);
+
+	// Carry the observables of a system over the samples it replayed after saturation
+	void replay(const SurfaceGrowth<Integer, FloatingPoint>& growth, LocalWidth<FloatingPoint>& localWidth,
+		HeightHistogram<FloatingPoint>& heightHistogram, unsigned id) const;
+
 public:
-	// Constructor functions
-	explicit SurfaceGrowthEnsemble(unsigned size)
-	: SurfaceGrowth<Integer, FloatingPoint>(size), _surface(size) {}
+	// Partial ensemble results, copied while a job runs. count[i] is the number of systems
+	// merged into data[i], taken at nl[i].
+	struct Snapshot {
+		std::vector<FloatingPoint> nl;
+		std::vector<unsigned> count;
+		std::vector<StatisticalData<SurfaceData<FloatingPoint>, FloatingPoint>> data;
+		StatisticalData<SurfaceData<FloatingPoint>, FloatingPoint> logInclination;
+		StatisticalData<SurfaceData<FloatingPoint>, FloatingPoint> logIndependent;
+	};
+
+	// Handle of an asynchronous multithreaded deposition. The ensemble must outlive it.
+	// The last copy of a job waits for it when destroyed, so keep one while it runs.
+	class [[nodiscard]] Job {
+		const SurfaceGrowthEnsemble* _ensemble;
+		std::shared_ptr<JobControl> _control;
+		std::shared_future<void> _future;
+
+	public:
+		Job(const SurfaceGrowthEnsemble* ensemble, const std::shared_ptr<JobControl>& control, const std::shared_future<void>& future)
+		: _ensemble(ensemble), _control(control), _future(future) {}
+
+		// Completion
+		inline bool ready() const {return _future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;}
+		inline void wait() const {_future.wait();}
+		inline void get() const {_future.get();}
+
+		// Cancel: running systems are abandoned and not merged.
+		inline void cancel() {_control->cancel();}
+		inline bool cancelled() const {return _control->cancelled();}
+
+		// Progress
+		inline unsigned completed() const {return _control->completed();}
+		inline unsigned total() const {return systems;}
+		inline double systemsPerSecond() const {return _control->systemsPerSecond();}
+		inline double depositionsPerSecond() const {return _control->depositionsPerSecond();}
+
+		// Ensemble averages over the systems completed so far.
+		inline Snapshot snapshot() const {return _ensemble->snapshot();}
+	};
+
+
+	// Constructor functions. Every grid comes from the resource (e.g. a MappedResource).
+	explicit SurfaceGrowthEnsemble(unsigned size, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+	: SurfaceGrowth<Integer, FloatingPoint>(size, resource), _surface(size, resource), _resource(resource) {}
 	
-	explicit SurfaceGrowthEnsemble(const Surface<Integer>& surface)
-	: SurfaceGrowth<Integer, FloatingPoint>(surface), _surface(surface) {}
+	explicit SurfaceGrowthEnsemble(const Surface<Integer>& surface, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+	: SurfaceGrowth<Integer, FloatingPoint>(surface, resource), _surface(surface, resource), _resource(resource) {}
 	
-	SurfaceGrowthEnsemble(unsigned sx, unsigned sy)
-	: SurfaceGrowth<Integer, FloatingPoint>(sx, sy), _surface(sx, sy) {}
+	SurfaceGrowthEnsemble(unsigned sx, unsigned sy, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+	: SurfaceGrowth<Integer, FloatingPoint>(sx, sy, resource), _surface(sx, sy, resource), _resource(resource) {}
 
 
 	// Single threaded deposition
@@ -39,6 +125,15 @@ public:
 	void multithreadDeposition(unsigned threads,
 		unsigned deposition_per_iteration, const FloatingPoint& nltotal,
 		std::function<void(Surface<Integer>& surface,int)> depositionMethod);
+
+	// Non-blocking multithreaded deposition. Do not touch the ensemble until the job is done.
+	// An exception from a worker cancels the job and is rethrown by Job::get(). Discarding
+	// the returned job blocks until the run ends, like a plain multithreadDeposition().
+	[[nodiscard]] Job submit(unsigned threads, unsigned deposition_per_iteration, const FloatingPoint& nltotal,
+		std::function<void(Surface<Integer>& surface,int)> depositionMethod);
+
+	// Copy of the ensemble results so far. Safe while a job is running.
+	Snapshot snapshot() const;
 	
 	// Accessing Functions
 	inline const StatisticalData<SurfaceData<FloatingPoint>, FloatingPoint>& logInclination() const {
@@ -49,6 +144,53 @@ public:
 		return _log_independent;
 	}
 
+	inline const LocalWidth<FloatingPoint>& localWidth() const {return _local_width;}
+	inline const HeightHistogram<FloatingPoint>& heightHistogram() const {return _height_histogram;}
+	inline const ExponentResampling<FloatingPoint>& exponentResampling() const {return _resampling;}
+	inline const std::vector<typename ExponentResampling<FloatingPoint>::Exponent>& exponentErrors() const {return _exponents;}
+
+	// Enable the local width observable for the given window sizes.
+	inline void measureLocalWidth(const std::vector<unsigned>& scales) {
+		_local_width = LocalWidth<FloatingPoint>(scales);
+	}
+
+	// Memory resource for the grids of the multithreaded workers, if not the one given
+	// to the constructor.
+	inline void storage(std::pmr::memory_resource* resource) {_resource = resource;}
+
+	// Pin each worker to a core, spread over the NUMA nodes, and build its grid and
+	// accumulators from the pinned thread so they are first-touched on its node.
+	// The nodes, and where every worker actually runs, are reported on std::clog.
+	inline void affinity(bool enable) {_affinity = enable;}
+
+	// Send profile snapshots to the writer, tagged with the system number. The writer must outlive the run.
+	// Multithreaded runs allow it a spare buffer per worker; see ProfileWriter::dropped().
+	inline void snapshots(ProfileWriter* writer) {_snapshots = writer;}
+
+	// Stop every system some samples after its width saturates. Its stationary samples, with
+	// their local width and histograms, are carried forward up to nltotal, so every time is
+	// still averaged over all the systems. Snapshots scheduled after the stop take the last
+	// grown profile. Late-time width averages run about 1-3% low against full growth.
+	inline void stopAtSaturation(const SaturationDetector<FloatingPoint>& detector) {
+		SurfaceGrowth<Integer, FloatingPoint>::stopAtSaturation(detector);
+	}
+
+	// Keep the per-system time series for jackknife/bootstrap errors over the given fit windows.
+	inline void measureExponentErrors(const std::vector<typename ExponentResampling<FloatingPoint>::Window>& windows) {
+		_resampling = ExponentResampling<FloatingPoint>(windows);
+		_exponents.clear();
+	}
+
+	// Compute the exponents and their errors from the systems grown so far. saveJson()
+	// exports the last result, so call this again after further depositions.
+	const std::vector<typename ExponentResampling<FloatingPoint>::Exponent>& computeExponentErrors(
+		unsigned resamples, unsigned threads, unsigned seed = 0);
+
+	// Enable the histogram of (h - <h>) over [from, to) with the given number of bins.
+	inline void measureHeightHistogram(const FloatingPoint& from, const FloatingPoint& to, unsigned bins) {
+		_height_histogram = HeightHistogram<FloatingPoint>(from, to, bins);
+	}
+
 	// Save dynamics at file. FIXME: ERASE ME!
 	void saveFile(const std::string& str) const;
 
@@ -61,83 +203,223 @@ void SurfaceGrowthEnsemble<Integer, FloatingPoint, systems>::deposition(
 unsigned deposition_per_iteration, const FloatingPoint& nltotal,
 std::function<void(Surface<Integer>& surface,int)> depositionMethod) {
 
-	for (int s = 0; s < systems; ++s) {
+	// Measurement of the optional observables, per system
+	unsigned s = 0;
+	LocalWidth<FloatingPoint> localWidth(_local_width.scales());
+	HeightHistogram<FloatingPoint> heightHistogram(_height_histogram.from(), _height_histogram.to(), _height_histogram.bins());
+	std::function<void(const SurfaceGrowth<Integer, FloatingPoint>&)> measurement = nullptr;
+	if (!localWidth.empty() || !heightHistogram.empty() || _snapshots) measurement = [&](const SurfaceGrowth<Integer, FloatingPoint>& growth) {
+		unsigned time = growth.dataSize()-1;
+		if (!localWidth.empty()) localWidth.measure(growth, time);
+		if (!heightHistogram.empty()) heightHistogram.measure(growth, growth.dataValue(time).height(), time);
+		if (_snapshots) _snapshots->measure(growth, s);
+	};
+
+	// Room for the whole time series
+	SurfaceGrowth<Integer, FloatingPoint>::reserve(deposition_per_iteration, nltotal);
+
+	for (s = 0; s < systems; ++s) {
 		// Run the deposition
 		SurfaceGrowth<Integer, FloatingPoint>::clear(_surface);
-		SurfaceGrowth<Integer, FloatingPoint>::deposition(deposition_per_iteration, nltotal, depositionMethod);
+		localWidth.clear();
+		heightHistogram.clear();
+		SurfaceGrowth<Integer, FloatingPoint>::deposition(deposition_per_iteration, nltotal, depositionMethod, measurement);
+		replay(*this, localWidth, heightHistogram, s);
 	
 		// Size of the dataset
-		int sz = SurfaceGrowth<Integer, FloatingPoint>::_data.size();
-		if (s == 0) _data.resize(sz);
+		unsigned sz = SurfaceGrowth<Integer, FloatingPoint>::_data.size();
+		if (_data.size() < sz) _data.resize(sz);
 
 		// Update the surface ensemble
-		for (int i = 0; i < sz; ++i) _data[i].newData(SurfaceGrowth<Integer, FloatingPoint>::_data[i]);
+		for (unsigned i = 0; i < sz; ++i) _data[i].newData(SurfaceGrowth<Integer, FloatingPoint>::_data[i]);
+		if (!localWidth.empty()) _local_width.newData(localWidth);
+		if (!heightHistogram.empty()) _height_histogram.newData(heightHistogram);
 	
 		// Compute the loglog linear coeficients.
-		auto coeff = SurfaceGrowth<Integer, FloatingPoint>::loglogfit();
+		std::array<SurfaceData<FloatingPoint>, 2> coeff;
+		{
+			SURFACE_PROFILE_SCOPE(Fit);
+			coeff = SurfaceGrowth<Integer, FloatingPoint>::loglogfit();
+		}
 		_log_inclination.newData(coeff[0]);
 		_log_independent.newData(coeff[1]);
-	}
+		if (!_resampling.empty()) _resampling.newData(*this);
 
-	_nl = SurfaceGrowth<Integer, FloatingPoint>::_nl;
+		// Systems may stop at saturation: keep the longest time series
+		if (_nl.size() < SurfaceGrowth<Integer, FloatingPoint>::_nl.size()) _nl = SurfaceGrowth<Integer, FloatingPoint>::_nl;
+	}
 }
 
 template <typename Integer, typename FloatingPoint, unsigned systems>
 void SurfaceGrowthEnsemble<Integer, FloatingPoint, systems>::multithreadDeposition(
 unsigned threads, unsigned deposition_per_iteration, const FloatingPoint& nltotal,
 std::function<void(Surface<Integer>& surface,int)> depositionMethod) {
+	JobControl control;
+	run(threads, deposition_per_iteration, nltotal, depositionMethod, control);
+}
+
+template <typename Integer, typename FloatingPoint, unsigned systems>
+typename SurfaceGrowthEnsemble<Integer, FloatingPoint, systems>::Job SurfaceGrowthEnsemble<Integer, FloatingPoint, systems>::submit(
+unsigned threads, unsigned deposition_per_iteration, const FloatingPoint& nltotal,
+std::function<void(Surface<Integer>& surface,int)> depositionMethod) {
+	std::shared_ptr<JobControl> control = std::make_shared<JobControl>();
+	std::shared_future<void> future = std::async(std::launch::async, [=]() {
+		run(threads, deposition_per_iteration, nltotal, depositionMethod, *control);
+	}).share();
 
-	// Mutex
-	std::mutex mutex;
+	return Job(this, control, future);
+}
 
-	// Lambda deposition function
-	auto lambda_deposition = [&]() {
-		
-		// Initialize surface and do deposition
-		SurfaceGrowth<Integer, FloatingPoint> growthSurface(_surface);
-		growthSurface.deposition(deposition_per_iteration, nltotal, depositionMethod);
+template <typename Integer, typename FloatingPoint, unsigned systems>
+typename SurfaceGrowthEnsemble<Integer, FloatingPoint, systems>::Snapshot SurfaceGrowthEnsemble<Integer, FloatingPoint, systems>::snapshot() const {
+	std::lock_guard<std::mutex> guard(_mutex);
+	Snapshot result;
+	result.data = _data;
+	result.logInclination = _log_inclination;
+	result.logIndependent = _log_independent;
+
+	// Times and number of systems for every point
+	unsigned size = _data.size();
+	result.nl.assign(_nl.begin(), _nl.begin() + std::min<std::size_t>(_nl.size(), size));
+	FloatingPoint nlcurrent = result.nl.empty() ? FloatingPoint() : result.nl.back() + _step;
+	while (result.nl.size() < size) {
+		result.nl.push_back(nlcurrent);
+		nlcurrent += _step;
+	}
 
-		// Lock the resources using the mutex
-		std::lock_guard<std::mutex> guard(mutex);
+	result.count.resize(size);
+	for (unsigned i = 0; i < size; ++i) result.count[i] = _data[i].size();
+	return result;
+}
 
-		// Check the size of the data
-		int sz = growthSurface.dataSize();
-		if (_data.empty()) _data.resize(sz);
-		
-		// Update the surface ensemble.
-		for (int i = 0; i < sz; ++i) _data[i].newData(growthSurface.dataValue(i));
-		
-		// Compute the loglog linear coeficients
-		auto coeff = growthSurface.loglogfit();
-		_log_inclination.newData(coeff[0]);
-		_log_independent.newData(coeff[1]);
-	};
+template <typename Integer, typename FloatingPoint, unsigned systems>
+void SurfaceGrowthEnsemble<Integer, FloatingPoint, systems>::replay(
+const SurfaceGrowth<Integer, FloatingPoint>& growth, LocalWidth<FloatingPoint>& localWidth,
+HeightHistogram<FloatingPoint>& heightHistogram, unsigned id) const {
+	if (growth.grownSize() == growth.dataSize()) return;
+
+	for (unsigned t = growth.grownSize(); t < growth.dataSize(); ++t) {
+		if (!localWidth.empty()) localWidth.replay(t, growth.grownIndex(t));
+		if (!heightHistogram.empty()) heightHistogram.replay(t, growth.grownIndex(t));
+	}
+	if (_snapshots) _snapshots->replay(growth, id);
+}
 
-	// Initialize the threads
-	int done = 0;
-	std::vector<std::thread> thread_vector;
-	
-	// Handle the threads
-	while (done < systems) {
-		int total = std::min(threads, systems-done);
+template <typename Integer, typename FloatingPoint, unsigned systems>
+void SurfaceGrowthEnsemble<Integer, FloatingPoint, systems>::run(
+unsigned threads, unsigned deposition_per_iteration, const FloatingPoint& nltotal,
+const std::function<void(Surface<Integer>& surface,int)>& depositionMethod, JobControl& control) {
 
-		// Create the threads and execute the lambda
-		for (int i = 0; i < total; ++i) {
-			thread_vector.emplace_back(lambda_deposition);
-		}
+	// Next system to run
+	std::atomic<unsigned> system(0);
 
-		// Wait for termination of the threads.
-		for (std::thread& th : thread_vector) {
-			th.join();
-			++done;
+	// First exception thrown by a worker
+	std::exception_ptr error = nullptr;
+
+	// Time step, for snapshots taken during the run
+	{
+		std::lock_guard<std::mutex> guard(_mutex);
+		_step = static_cast<FloatingPoint>(deposition_per_iteration) / static_cast<FloatingPoint>(_surface.size());
+	}
+
+	// Placement of the workers
+	Topology topology;
+	if (_affinity) topology = Topology::detect();
+
+	// Lambda deposition function. Each thread keeps one worker and its observables,
+	// reused for every system it runs, so the steady state does not allocate.
+	// An exception is kept for the caller and cancels the other workers.
+	auto lambda_deposition = [&](unsigned worker) {
+		try {
+			// Pin before allocating, so the memory of the worker is local to its node
+			if (_affinity) {
+				bool pinned = Topology::pin(topology.cpuOf(worker));
+				std::lock_guard<std::mutex> guard(_mutex);
+				topology.report(std::clog, worker, pinned);
+			}
+		
+			// Observables local to this thread
+			unsigned id = 0;
+			LocalWidth<FloatingPoint> localWidth(_local_width.scales());
+			HeightHistogram<FloatingPoint> heightHistogram(_height_histogram.from(), _height_histogram.to(), _height_histogram.bins());
+			ExponentResampling<FloatingPoint> resampling(_resampling.windows());
+			std::function<void(const SurfaceGrowth<Integer, FloatingPoint>&)> measurement = nullptr;
+			if (!localWidth.empty() || !heightHistogram.empty() || _snapshots) measurement = [&](const SurfaceGrowth<Integer, FloatingPoint>& growth) {
+				unsigned time = growth.dataSize()-1;
+				if (!localWidth.empty()) localWidth.measure(growth, time);
+				if (!heightHistogram.empty()) heightHistogram.measure(growth, growth.dataValue(time).height(), time);
+				if (_snapshots) _snapshots->measure(growth, id);
+			};
+
+			// Worker surface, with room for the whole time series
+			SurfaceGrowth<Integer, FloatingPoint> growthSurface(_surface, _resource);
+			growthSurface.stopAtSaturation(SurfaceGrowth<Integer, FloatingPoint>::saturation());
+			growthSurface.reserve(deposition_per_iteration, nltotal);
+			growthSurface.stopWhen(control.flag());
+
+			while (!control.cancelled() && (id = system++) < systems) {
+				// Reset the worker and do deposition
+				growthSurface.clear(_surface);
+				localWidth.clear();
+				heightHistogram.clear();
+				resampling.clear();
+				growthSurface.deposition(deposition_per_iteration, nltotal, depositionMethod, measurement);
+				if (control.cancelled()) break;
+				replay(growthSurface, localWidth, heightHistogram, id);
+
+				// Compute the loglog linear coeficients and the resampling sums of this
+				// system before taking the lock, so that only the merges are serialized.
+				std::array<SurfaceData<FloatingPoint>, 2> coeff;
+				{
+					SURFACE_PROFILE_SCOPE(Fit);
+					coeff = growthSurface.loglogfit();
+				}
+				if (!resampling.empty()) resampling.newData(growthSurface);
+
+				// Lock the resources using the mutex
+				SURFACE_PROFILE_LOCK(_mutex);
+
+				// Check the size of the data
+				unsigned sz = growthSurface.dataSize();
+				if (_data.size() < sz) _data.resize(sz);
+			
+				// Update the surface ensemble.
+				for (unsigned i = 0; i < sz; ++i) _data[i].newData(growthSurface.dataValue(i));
+				_log_inclination.newData(coeff[0]);
+				_log_independent.newData(coeff[1]);
+
+				// Merge the observables
+				if (!localWidth.empty()) _local_width.newData(localWidth);
+				if (!heightHistogram.empty()) _height_histogram.newData(heightHistogram);
+				if (!resampling.empty()) _resampling.newData(resampling);
+
+				control.systemDone(static_cast<unsigned long long>(growthSurface.grownSize()) * deposition_per_iteration);
+			}
+		} catch (...) {
+			std::lock_guard<std::mutex> guard(_mutex);
+			if (!error) error = std::current_exception();
+			control.cancel();
 		}
+	};
 
-		// Clear the thread_vector
-		thread_vector.clear();
+	// Create the threads and execute the lambda. They take systems until none are left.
+	unsigned total = std::min(threads, systems);
+	if (_snapshots) _snapshots->producers(total);
+	if (_affinity) topology.report(std::clog, 0);
+
+	std::vector<std::thread> thread_vector;
+	for (unsigned i = 0; i < total; ++i) {
+		thread_vector.emplace_back(lambda_deposition, i);
+	}
+
+	// Wait for termination of the threads.
+	for (std::thread& th : thread_vector) {
+		th.join();
 	}
 
 	// Calculate the nl values.
 	// FIXME: Possible solution: To have an bool argument in the lambda, to set _nl from growthSurface.
+	std::unique_lock<std::mutex> lock(_mutex);
 	int size = _data.size();
 	FloatingPoint szz = static_cast<FloatingPoint>(_surface.size());
 	FloatingPoint deppi = static_cast<FloatingPoint>(deposition_per_iteration);
@@ -151,10 +433,24 @@ std::function<void(Surface<Integer>& surface,int)> depositionMethod) {
 		_nl.push_back(nlcurrent);
 		nlcurrent += step;
 	}
+	lock.unlock();
+
+	if (error) std::rethrow_exception(error);
+}
+
+template <typename Integer, typename FloatingPoint, unsigned systems>
+const std::vector<typename ExponentResampling<FloatingPoint>::Exponent>&
+SurfaceGrowthEnsemble<Integer, FloatingPoint, systems>::computeExponentErrors(unsigned resamples, unsigned threads, unsigned seed) {
+	SURFACE_PROFILE_SCOPE(Fit);
+	_exponents = _resampling.compute(resamples, threads, seed);
+	_resamples = resamples;
+	_seed = seed;
+	return _exponents;
 }
 
 template <typename Integer, typename FloatingPoint, unsigned systems>
 void SurfaceGrowthEnsemble<Integer, FloatingPoint, systems>::saveJson(std::string& str) const {
+	SURFACE_PROFILE_SCOPE(Json);
 	Json::Value root;
 	// Deposition method
 	root["deposition-type"] = "";
@@ -166,7 +462,7 @@ void SurfaceGrowthEnsemble<Integer, FloatingPoint, systems>::saveJson(std::strin
 	// Initial Surface
 	int szi = _surface.size();
 	for (int i = 0; i < szi; ++i) {
-		root["initial-surface"]["surface"]["value"][i] = _surface[i];
+		root["initial-surface"]["surface"]["value"][i] = Json::Int64(_surface.height(i));
 	}
 	
 	// TODO: Final Surface
@@ -175,6 +471,9 @@ void SurfaceGrowthEnsemble<Integer, FloatingPoint, systems>::saveJson(std::strin
 	int sz = _nl.size();
 	for (int i = 0; i < sz; ++i) root["growth"]["nl"][i] = _nl[i];
 	
+	// Number of systems that reached every time
+	for (int i = 0; i < sz; ++i) root["growth"]["systems"][i] = _data[i].size();
+
 	std::array<std::string, 2> _stat_arg = {"average", "variance"};
 	std::array<std::string, 4> _data_arg = {"height", "width", "skewness", "kurtosis"};
 	for (const std::string& stat_arg : _stat_arg) {
@@ -189,6 +488,63 @@ void SurfaceGrowthEnsemble<Integer, FloatingPoint, systems>::saveJson(std::strin
 		}
 	}
 
+	// Local width w(l) for every time
+	if (!_local_width.empty()) {
+		int szs = _local_width.scales().size();
+		int szt = _local_width.timeSize();
+		for (int k = 0; k < szs; ++k) root["local-width"]["scale"][k] = _local_width.scales()[k];
+		for (const std::string& stat_arg : _stat_arg) {
+			for (int i = 0; i < szt; ++i) {
+				for (int k = 0; k < szs; ++k) 
+					root["local-width"][stat_arg][i][k] = _local_width.data(i, k)[stat_arg];
+			}
+		}
+	}
+
+	// Distribution of the height fluctuations for every time
+	if (!_height_histogram.empty()) {
+		int szb = _height_histogram.bins();
+		int szt = _height_histogram.timeSize();
+		root["height-distribution"]["from"] = _height_histogram.from();
+		root["height-distribution"]["to"] = _height_histogram.to();
+		for (int b = 0; b < szb; ++b) root["height-distribution"]["center"][b] = _height_histogram.binCenter(b);
+		for (int i = 0; i < szt; ++i) {
+			for (int b = 0; b < szb; ++b) 
+				root["height-distribution"]["count"][i][b] = Json::UInt64(_height_histogram.count(i, b));
+			root["height-distribution"]["underflow"][i] = Json::UInt64(_height_histogram.underflow(i));
+			root["height-distribution"]["overflow"][i] = Json::UInt64(_height_histogram.overflow(i));
+		}
+	}
+
+	// Resampling errors of the exponents for every fit window, as last computed
+	if (!_exponents.empty()) {
+		root["exponent-errors"]["resamples"] = _resamples;
+		root["exponent-errors"]["seed"] = _seed;
+		int szw = _exponents.size();
+		for (int w = 0; w < szw; ++w) {
+			root["exponent-errors"]["from"][w] = _resampling.windows()[w].first;
+			root["exponent-errors"]["to"][w] = _resampling.windows()[w].second;
+			for (const std::string& data_arg : _data_arg) {
+				root["exponent-errors"]["inclination"][data_arg][w] = _exponents[w].inclination[data_arg];
+				root["exponent-errors"]["jackknife"][data_arg][w] = _exponents[w].jackknife[data_arg];
+				root["exponent-errors"]["bootstrap"][data_arg][w] = _exponents[w].bootstrap[data_arg];
+			}
+		}
+	}
+
+#ifdef SURFACE_PROFILE
+	// Timing of the phases so far
+	ProfileCounters profile = Profiler::instance().summary();
+	double tick = Profiler::instance().tickSeconds();
+	for (unsigned i = 0; i < ProfileCounters::phases; ++i) {
+		root["profile"][Profiler::name(i)]["seconds"] = profile.ticks[i] * tick;
+		root["profile"][Profiler::name(i)]["calls"] = Json::UInt64(profile.calls[i]);
+	}
+	root["profile"]["depositions"] = Json::UInt64(profile.depositions);
+	for (unsigned i = 0; i < ProfileCounters::buckets; ++i) 
+		root["profile"]["lock-wait-histogram"][i] = Json::UInt64(profile.lockWait[i]);
+#endif
+
 	// Return
 	Json::StreamWriterBuilder writer;
 	str = Json::writeString(writer, root);
@@ -1,6 +1,10 @@
 #pragma once
 #include "surface.hpp"
+#include "profiler.hpp"
+#include "saturation.hpp"
+#include "mapped.hpp"
 #include <functional>
+#include <atomic>
 #include <fstream>
 #include <string>
 #include <cmath>
@@ -12,20 +16,57 @@ protected:
 	std::vector<SurfaceData<FloatingPoint>> _data;
 	std::vector<FloatingPoint> _nl;
 
+	// Optional early stop once the width saturates. Samples from _grown on replay the
+	// grown ones from _stationary on.
+	SaturationDetector<FloatingPoint> _saturation;
+	unsigned _grown = 0;
+	unsigned _stationary = 0;
+
+	// Optional flag to abandon the deposition (cooperative cancellation)
+	const std::atomic<bool>* _stop = nullptr;
+
 public:
 	// Constructor Functions
-	explicit SurfaceGrowth(unsigned size) : Surface<Integer>(size) {}
-	explicit SurfaceGrowth(const Surface<Integer>& surface) : Surface<Integer>(surface) {}
-	SurfaceGrowth(unsigned sx, unsigned sy) : Surface<Integer>(sx, sy) {}
+	explicit SurfaceGrowth(unsigned size, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+	: Surface<Integer>(size, resource) {}
+	
+	explicit SurfaceGrowth(const Surface<Integer>& surface, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+	: Surface<Integer>(surface, resource) {}
+	
+	SurfaceGrowth(unsigned sx, unsigned sy, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+	: Surface<Integer>(sx, sy, resource) {}
 	
 	// Inline Functions
 	inline unsigned nlSize() const {return _nl.size();}
 	inline unsigned dataSize() const {return _data.size();}
 	inline auto& dataValue(unsigned i) const {return _data[i];}
+	inline const FloatingPoint& nlValue(unsigned i) const {return _nl[i];}
+	inline const SaturationDetector<FloatingPoint>& saturation() const {return _saturation;}
+
+	// Number of samples actually grown, and the grown sample that sample i repeats.
+	inline unsigned grownSize() const {return _grown;}
+	inline unsigned grownIndex(unsigned i) const {
+		return i < _grown ? i : _stationary + (i - _grown) % (_grown - _stationary);
+	}
+
+	// Stop the deposition some samples after the width saturates, before nltotal. The rest of
+	// the time series, up to nltotal, replays the stationary samples in order, so that every
+	// system covers the same times. Measurement callbacks only see the grown samples; see
+	// grownIndex() to carry their results over the replayed ones.
+	// The replayed widths come from the first stationary samples, so late-time averages of
+	// the width run about 1-3% low compared with growing every system up to nltotal.
+	inline void stopAtSaturation(const SaturationDetector<FloatingPoint>& detector) {_saturation = detector;}
+
+	// Stop the deposition at the next iteration once the flag is set.
+	inline void stopWhen(const std::atomic<bool>* flag) {_stop = flag;}
 
-	// Growth Functions
+	// Growth Functions. The optional measurement is called after every iteration's surfaceData().
 	void deposition(unsigned deposition_per_iteration, const FloatingPoint& nltotal, 
-		std::function<void(Surface<Integer>& surface,int)> depositionMethod);
+		const std::function<void(Surface<Integer>& surface,int)>& depositionMethod,
+		const std::function<void(const SurfaceGrowth&)>& measurement = nullptr);
+
+	// Reserve the time series for a deposition up to nltotal, so that it does not allocate.
+	void reserve(unsigned deposition_per_iteration, const FloatingPoint& nltotal);
 
 	// Modifying the surface
 	void clear();
@@ -44,7 +85,8 @@ public:
 template <typename Integer, typename FloatingPoint>
 void SurfaceGrowth<Integer, FloatingPoint>::deposition(
 unsigned deposition_per_iteration, const FloatingPoint& nltotal, 
-std::function<void(Surface<Integer>& surface,int)> depositionMethod) {
+const std::function<void(Surface<Integer>& surface,int)>& depositionMethod,
+const std::function<void(const SurfaceGrowth&)>& measurement) {
 	
 	// Find the current nl value to begin with.
 	FloatingPoint nlcurrent;
@@ -53,26 +95,70 @@ std::function<void(Surface<Integer>& surface,int)> depositionMethod) {
 	
 	// Peform the Surface Growth.
 	while (nlcurrent < nltotal) {
-		// Peform the deposition
-		depositionMethod(*this, deposition_per_iteration);
+		if (_stop && _stop->load(std::memory_order_relaxed)) break;
+
+		// Peform the deposition, in chunks that fit the integer type of the heights
+		{
+			SURFACE_PROFILE_SCOPE(Deposition);
+			adviseAccess(*this, MappedAccess::Random);
+			unsigned remaining = deposition_per_iteration;
+			while (remaining > 0) {
+				unsigned chunk = this->reserveHeadroom(remaining);
+				depositionMethod(*this, chunk);
+				remaining -= chunk;
+			}
+			SURFACE_PROFILE_DEPOSITIONS(deposition_per_iteration);
+		}
 		
 		// Save the data
-		_nl.push_back(nlcurrent);
-		_data.push_back(this->template surfaceData<FloatingPoint>());
-		// https://stackoverflow.com/questions/3505713/c-template-compilation-error-expected-primary-expression-before-token
-		
+		{
+			SURFACE_PROFILE_SCOPE(Measurement);
+			adviseAccess(*this, MappedAccess::Sequential);
+			_nl.push_back(nlcurrent);
+			_data.push_back(this->template surfaceData<FloatingPoint>());
+			_grown = _data.size();
+			// https://stackoverflow.com/questions/3505713/c-template-compilation-error-expected-primary-expression-before-token
+			if (measurement) measurement(*this);
+		}
+
 		// Upgrade time passage
 		FloatingPoint deppi = static_cast<FloatingPoint>(deposition_per_iteration);
 		FloatingPoint szz = static_cast<FloatingPoint>(this->size());
 		nlcurrent += deppi / szz;
+
+		// Stop in the saturated regime, carrying the stationary samples forward
+		if (_saturation.enabled() && _saturation.newData(_nl.back(), _data.back().width())) {
+			_stationary = _saturation.stationary();
+			for (unsigned k = 0; nlcurrent < nltotal; ++k) {
+				_nl.push_back(nlcurrent);
+				_data.push_back(_data[grownIndex(_grown + k)]);
+				nlcurrent += deppi / szz;
+			}
+			break;
+		}
 	}
 }
 
+template <typename Integer, typename FloatingPoint>
+void SurfaceGrowth<Integer, FloatingPoint>::reserve(unsigned deposition_per_iteration, const FloatingPoint& nltotal) {
+	FloatingPoint nlcurrent = _nl.empty() ? FloatingPoint() : _nl.back();
+	FloatingPoint step = static_cast<FloatingPoint>(deposition_per_iteration) / static_cast<FloatingPoint>(this->size());
+	if (!(step > 0) || !(nltotal > nlcurrent)) return;
+
+	// One extra for the rounding of nlcurrent along the way.
+	unsigned count = _nl.size() + static_cast<unsigned>(std::ceil((nltotal - nlcurrent) / step)) + 1;
+	_nl.reserve(count);
+	_data.reserve(count);
+	if (_saturation.enabled()) _saturation.reserve(count);
+}
+
 template <typename Integer, typename FloatingPoint>
 void SurfaceGrowth<Integer, FloatingPoint>::clear() {
 	Surface<Integer>::clear();
 	_nl.clear();
 	_data.clear();
+	_saturation.clear();
+	_grown = _stationary = 0;
 }
 
 template <typename Integer, typename FloatingPoint>
@@ -80,6 +166,8 @@ void SurfaceGrowth<Integer, FloatingPoint>::clear(const Surface<Integer>& surfac
 	Surface<Integer>::clear(surface);
 	_nl.clear();
 	_data.clear();
+	_saturation.clear();
+	_grown = _stationary = 0;
 }
 
 // Including from. Excluding to.
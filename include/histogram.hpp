@@ -0,0 +1,136 @@
+#pragma once
+#include "surface.hpp"
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <istream>
+#include <ostream>
+
+// Fixed-memory histogram of the height fluctuations (h - <h>) for every measurement time.
+// The bins span [from, to); values outside are kept in an underflow and an overflow bin.
+template <typename FloatingPoint>
+class HeightHistogram {
+	// Binning
+	FloatingPoint _from;
+	FloatingPoint _to;
+	unsigned _bins;
+
+	// Counts. Each time has bins+2 entries: underflow, bins..., overflow.
+	std::vector<unsigned long long> _counts;
+
+	inline unsigned stride() const {return _bins + 2;}
+
+public:
+	// Constructor functions
+	HeightHistogram() : _from(), _to(), _bins(0) {}
+	HeightHistogram(const FloatingPoint& from, const FloatingPoint& to, unsigned bins)
+	: _from(from), _to(to), _bins(bins) {}
+
+	// Accessor functions
+	inline bool empty() const {return _bins == 0;}
+	inline unsigned bins() const {return _bins;}
+	inline unsigned timeSize() const {return _bins ? _counts.size() / stride() : 0;}
+	inline FloatingPoint from() const {return _from;}
+	inline FloatingPoint to() const {return _to;}
+	inline FloatingPoint binWidth() const {return (_to - _from) / static_cast<FloatingPoint>(_bins);}
+	inline FloatingPoint binCenter(unsigned bin) const {return _from + (static_cast<FloatingPoint>(bin) + FloatingPoint(0.5)) * binWidth();}
+
+	inline unsigned long long count(unsigned time, unsigned bin) const {return _counts[stride() * time + bin + 1];}
+	inline unsigned long long underflow(unsigned time) const {return _counts[stride() * time];}
+	inline unsigned long long overflow(unsigned time) const {return _counts[stride() * time + _bins + 1];}
+	unsigned long long total(unsigned time) const;
+
+	// Normalized probability density of a bin.
+	FloatingPoint density(unsigned time, unsigned bin) const;
+
+	// Register the fluctuations of a surface whose average height is already known.
+	template <typename Integer>
+	void measure(const Surface<Integer>& surface, const FloatingPoint& average, unsigned time);
+
+	// Copy the counts of the source time to another time.
+	void replay(unsigned time, unsigned source);
+
+	// Modification functions
+	void newData(const HeightHistogram& other);
+	void clear();
+
+	// Serialization, to merge histograms produced by other processes.
+	void save(std::ostream& stream) const;
+	void load(std::istream& stream);
+};
+
+
+template <typename FloatingPoint>
+unsigned long long HeightHistogram<FloatingPoint>::total(unsigned time) const {
+	unsigned long long result = 0;
+	for (unsigned i = 0; i < stride(); ++i) result += _counts[stride() * time + i];
+	return result;
+}
+
+template <typename FloatingPoint>
+FloatingPoint HeightHistogram<FloatingPoint>::density(unsigned time, unsigned bin) const {
+	FloatingPoint tot = static_cast<FloatingPoint>(total(time));
+	if (tot == 0) return FloatingPoint();
+	return static_cast<FloatingPoint>(count(time, bin)) / (tot * binWidth());
+}
+
+template <typename FloatingPoint>
+template <typename Integer>
+void HeightHistogram<FloatingPoint>::measure(const Surface<Integer>& surface, const FloatingPoint& average, unsigned time) {
+	if (timeSize() <= time) _counts.resize(stride() * (time+1));
+	unsigned long long* counts = &_counts[stride() * time];
+
+	FloatingPoint scale = static_cast<FloatingPoint>(_bins) / (_to - _from);
+	FloatingPoint offset = average - static_cast<FloatingPoint>(surface.base()) + _from;
+	unsigned size = surface.size();
+
+	for (unsigned i = 0; i < size; ++i) {
+		FloatingPoint position = (static_cast<FloatingPoint>(surface[i]) - offset) * scale;
+		if (position < 0) ++counts[0];
+		else if (position >= static_cast<FloatingPoint>(_bins)) ++counts[_bins + 1];
+		else ++counts[static_cast<unsigned>(position) + 1];
+	}
+}
+
+template <typename FloatingPoint>
+void HeightHistogram<FloatingPoint>::replay(unsigned time, unsigned source) {
+	if (timeSize() <= time) _counts.resize(stride() * (time+1));
+	std::copy_n(_counts.begin() + stride() * source, stride(), _counts.begin() + stride() * time);
+}
+
+template <typename FloatingPoint>
+void HeightHistogram<FloatingPoint>::newData(const HeightHistogram& other) {
+	if (other.empty()) return;
+	if (empty()) {
+		*this = other;
+		return;
+	}
+
+	if (_bins != other._bins || _from != other._from || _to != other._to)
+		throw "Mismatching binning at HeightHistogram::newData(const HeightHistogram&)";
+
+	if (_counts.size() < other._counts.size()) _counts.resize(other._counts.size());
+	for (unsigned i = 0; i < other._counts.size(); ++i) _counts[i] += other._counts[i];
+}
+
+template <typename FloatingPoint>
+void HeightHistogram<FloatingPoint>::clear() {
+	for (unsigned long long& count : _counts) count = 0;
+}
+
+template <typename FloatingPoint>
+void HeightHistogram<FloatingPoint>::save(std::ostream& stream) const {
+	stream.precision(17);
+	stream << _from << " " << _to << " " << _bins << " " << timeSize() << "\n";
+	for (unsigned long long count : _counts) stream << count << " ";
+	stream << "\n";
+}
+
+template <typename FloatingPoint>
+void HeightHistogram<FloatingPoint>::load(std::istream& stream) {
+	unsigned times;
+	stream >> _from >> _to >> _bins >> times;
+	_counts.resize(stride() * times);
+	for (unsigned long long& count : _counts) stream >> count;
+	if (!stream) throw "Invalid stream at HeightHistogram::load(std::istream&)";
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+
+// Shared state of a running ensemble job: cooperative cancellation and progress counters.
+// Workers poll cancelled() between iterations; everything else may be read from any thread.
+class JobControl {
+	std::atomic<bool> _cancel;
+	std::atomic<unsigned> _completed;
+	std::atomic<unsigned long long> _depositions;
+	std::chrono::steady_clock::time_point _start;
+
+public:
+	// Constructor functions
+	JobControl() : _cancel(false), _completed(0), _depositions(0), _start(std::chrono::steady_clock::now()) {}
+
+	JobControl(const JobControl&) = delete;
+	JobControl& operator=(const JobControl&) = delete;
+
+	// Cancellation
+	inline void cancel() {_cancel.store(true, std::memory_order_relaxed);}
+	inline bool cancelled() const {return _cancel.load(std::memory_order_relaxed);}
+	inline const std::atomic<bool>* flag() const {return &_cancel;}
+
+	// Progress
+	inline void systemDone(unsigned long long depositions) {
+		_depositions.fetch_add(depositions, std::memory_order_relaxed);
+		_completed.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	inline unsigned completed() const {return _completed.load(std::memory_order_relaxed);}
+	inline unsigned long long depositions() const {return _depositions.load(std::memory_order_relaxed);}
+
+	// Seconds since the job started
+	inline double elapsed() const {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+	}
+
+	// Throughput since the job started
+	inline double systemsPerSecond() const {double t = elapsed(); return t > 0 ? completed() / t : 0;}
+	inline double depositionsPerSecond() const {double t = elapsed(); return t > 0 ? depositions() / t : 0;}
+};
@@ -0,0 +1,151 @@
+#pragma once
+#include "surface.hpp"
+#include "statdata.hpp"
+#include <algorithm>
+#include <vector>
+#include <cmath>
+
+// Local roughness w(l) = < sqrt(<h^2>_l - <h>_l^2) > over all windows of size l.
+// In 2D mode the windows are squares of side l.
+template <typename FloatingPoint>
+class LocalWidth {
+	// Window sizes to measure.
+	std::vector<unsigned> _scales;
+
+	// Statistics of w(l). Indexed by [time][scale].
+	std::vector<std::vector<StatisticalData<FloatingPoint, FloatingPoint>>> _data;
+
+	// Prefix sums (summed-area tables in 2D) of h and h^2. Reused across measurements.
+	std::vector<long long> _sum;
+	std::vector<long long> _sum2;
+	std::vector<FloatingPoint> _width;
+
+public:
+	// Constructor functions
+	LocalWidth() {}
+	explicit LocalWidth(const std::vector<unsigned>& scales) : _scales(scales) {}
+
+	// Log-spaced window sizes between from and to (both included).
+	static std::vector<unsigned> logScales(unsigned from, unsigned to, unsigned points);
+
+	// Accessor functions
+	inline bool empty() const {return _scales.empty();}
+	inline const std::vector<unsigned>& scales() const {return _scales;}
+	inline unsigned timeSize() const {return _data.size();}
+	inline const StatisticalData<FloatingPoint, FloatingPoint>& data(unsigned time, unsigned scale) const {
+		return _data[time][scale];
+	}
+
+	// Compute w(l) of a surface for every scale.
+	template <typename Integer>
+	const std::vector<FloatingPoint>& width(const Surface<Integer>& surface);
+
+	// Compute w(l) and register it at the given time index.
+	template <typename Integer>
+	void measure(const Surface<Integer>& surface, unsigned time);
+
+	// Copy the measurements of the source time to another time.
+	void replay(unsigned time, unsigned source);
+
+	// Modification functions
+	void newData(const LocalWidth& other);
+	void clear();
+};
+
+
+template <typename FloatingPoint>
+std::vector<unsigned> LocalWidth<FloatingPoint>::logScales(unsigned from, unsigned to, unsigned points) {
+	std::vector<unsigned> result;
+	if (from < 1) from = 1;
+	if (points < 2 || to <= from) return std::vector<unsigned>(1, from);
+
+	double ratio = std::log(static_cast<double>(to) / from) / (points - 1);
+	for (unsigned i = 0; i < points; ++i) {
+		unsigned scale = static_cast<unsigned>(std::lround(from * std::exp(ratio * i)));
+		if (result.empty() || result.back() < scale) result.push_back(scale);
+	}
+
+	return result;
+}
+
+template <typename FloatingPoint>
+template <typename Integer>
+const std::vector<FloatingPoint>& LocalWidth<FloatingPoint>::width(const Surface<Integer>& surface) {
+	_width.resize(_scales.size());
+	unsigned sx = surface.sizex();
+	unsigned sy = surface.sizey();
+
+	// Heights are shifted by the first site so that the integer sums stay small and exact.
+	long long base = static_cast<long long>(surface[0]);
+
+	// Build the summed-area tables, with a zero row and column in front.
+	unsigned wx = sx + 1;
+	_sum.assign(wx * (sy + 1), 0);
+	_sum2.assign(wx * (sy + 1), 0);
+	for (unsigned y = 0; y < sy; ++y) {
+		long long row = 0, row2 = 0;
+		for (unsigned x = 0; x < sx; ++x) {
+			long long h = static_cast<long long>(surface(x, y)) - base;
+			row += h;
+			row2 += h * h;
+			_sum[wx * (y+1) + x+1] = _sum[wx * y + x+1] + row;
+			_sum2[wx * (y+1) + x+1] = _sum2[wx * y + x+1] + row2;
+		}
+	}
+
+	// Evaluate each scale in O(L) using the tables.
+	for (unsigned k = 0; k < _scales.size(); ++k) {
+		unsigned lx = std::min(_scales[k], sx);
+		unsigned ly = (sy == 1) ? 1 : std::min(_scales[k], sy);
+		double n = static_cast<double>(lx) * ly;
+		double total = 0;
+
+		for (unsigned y = 0; y + ly <= sy; ++y) {
+			for (unsigned x = 0; x + lx <= sx; ++x) {
+				unsigned a = wx * y + x, b = wx * y + x + lx;
+				unsigned c = wx * (y+ly) + x, d = wx * (y+ly) + x + lx;
+				double s1 = static_cast<double>(_sum[d] - _sum[b] - _sum[c] + _sum[a]) / n;
+				double s2 = static_cast<double>(_sum2[d] - _sum2[b] - _sum2[c] + _sum2[a]) / n;
+				double var = s2 - s1 * s1;
+				total += (var > 0) ? std::sqrt(var) : 0;
+			}
+		}
+
+		double windows = static_cast<double>(sx - lx + 1) * (sy - ly + 1);
+		_width[k] = static_cast<FloatingPoint>(total / windows);
+	}
+
+	return _width;
+}
+
+template <typename FloatingPoint>
+template <typename Integer>
+void LocalWidth<FloatingPoint>::measure(const Surface<Integer>& surface, unsigned time) {
+	if (_data.size() <= time) _data.resize(time+1, std::vector<StatisticalData<FloatingPoint, FloatingPoint>>(_scales.size()));
+
+	const std::vector<FloatingPoint>& w = width(surface);
+	for (unsigned k = 0; k < _scales.size(); ++k) _data[time][k].newData(w[k]);
+}
+
+template <typename FloatingPoint>
+void LocalWidth<FloatingPoint>::replay(unsigned time, unsigned source) {
+	if (_data.size() <= time) _data.resize(time+1, std::vector<StatisticalData<FloatingPoint, FloatingPoint>>(_scales.size()));
+	_data[time] = _data[source];
+}
+
+template <typename FloatingPoint>
+void LocalWidth<FloatingPoint>::newData(const LocalWidth& other) {
+	if (_scales != other._scales) throw "Mismatching scales at LocalWidth::newData(const LocalWidth&)";
+	if (_data.size() < other._data.size()) _data.resize(other._data.size(), std::vector<StatisticalData<FloatingPoint, FloatingPoint>>(_scales.size()));
+
+	for (unsigned t = 0; t < other._data.size(); ++t) {
+		for (unsigned k = 0; k < _scales.size(); ++k) _data[t][k].newData(other._data[t][k]);
+	}
+}
+
+template <typename FloatingPoint>
+void LocalWidth<FloatingPoint>::clear() {
+	for (auto& time : _data) {
+		for (auto& scale : time) scale.clear();
+	}
+}
@@ -0,0 +1,138 @@
+#pragma once
+#include "surface.hpp"
+#include <memory_resource>
+#include <string>
+#include <vector>
+#include <new>
+#include <cstdint>
+#include <cstdlib>
+#if defined(__unix__) || defined(__APPLE__)
+#define SURFACE_MAPPED
+#include <sys/mman.h>
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+// Access pattern hints for mapped grids.
+enum class MappedAccess {Normal, Sequential, Random, WillNeed, DontNeed};
+
+// Apply an access hint to the grid of a surface, e.g. Random before a deposition
+// burst and Sequential before a moment scan. Does nothing unless the grid is mapped.
+template <typename Integer>
+void adviseAccess(const Surface<Integer>& surface, MappedAccess access);
+
+// Mapped storage needs POSIX (mmap, mkstemp). Elsewhere only the no-op hints exist.
+#ifdef SURFACE_MAPPED
+
+// Memory resource that places every allocation in its own memory-mapped file, created
+// (and immediately unlinked) inside a directory. Lets grids grow beyond RAM, as long as
+// the directory is on a disk and not on a tmpfs (often the case for /tmp or /dev/shm):
+//     MappedResource storage("/scratch");
+//     Surface<int> surface(sx, sy, &storage);
+// Mappings are aligned and padded to 2 MiB so that transparent huge pages can back them.
+class MappedResource : public std::pmr::memory_resource {
+	std::string _directory;
+	MappedAccess _access;
+
+public:
+	static constexpr std::size_t alignment = std::size_t(2) << 20;
+
+	// Constructor functions
+	explicit MappedResource(const std::string& directory, MappedAccess access = MappedAccess::Sequential)
+	: _directory(directory), _access(access) {}
+
+	// Accessor functions
+	inline const std::string& directory() const {return _directory;}
+	inline MappedAccess access() const {return _access;}
+
+	// Apply an access hint to any memory range (rounded out to whole pages).
+	static void advise(const void* pointer, std::size_t bytes, MappedAccess access);
+
+protected:
+	void* do_allocate(std::size_t bytes, std::size_t align) override;
+	void do_deallocate(void* pointer, std::size_t bytes, std::size_t align) override;
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {return this == &other;}
+};
+
+
+inline void MappedResource::advise(const void* pointer, std::size_t bytes, MappedAccess access) {
+	int advice = MADV_NORMAL;
+	switch (access) {
+		case MappedAccess::Normal: advice = MADV_NORMAL; break;
+		case MappedAccess::Sequential: advice = MADV_SEQUENTIAL; break;
+		case MappedAccess::Random: advice = MADV_RANDOM; break;
+		case MappedAccess::WillNeed: advice = MADV_WILLNEED; break;
+		case MappedAccess::DontNeed: advice = MADV_DONTNEED; break;
+	}
+
+	// madvise needs page aligned ranges.
+	std::uintptr_t page = static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE));
+	std::uintptr_t begin = reinterpret_cast<std::uintptr_t>(pointer) & ~(page - 1);
+	std::uintptr_t end = reinterpret_cast<std::uintptr_t>(pointer) + bytes;
+	if (end > begin) madvise(reinterpret_cast<void*>(begin), end - begin, advice);
+}
+
+inline void* MappedResource::do_allocate(std::size_t bytes, std::size_t align) {
+	if (align > alignment) throw std::bad_alloc();
+	std::size_t length = (bytes + alignment - 1) / alignment * alignment;
+	if (length == 0) length = alignment;
+
+	// Create the backing file. It is unlinked at once, so it vanishes with the mapping.
+	std::vector<char> path(_directory.begin(), _directory.end());
+	const std::string suffix = "/surface-XXXXXX";
+	path.insert(path.end(), suffix.begin(), suffix.end());
+	path.push_back('\0');
+
+	int fd = mkstemp(path.data());
+	if (fd < 0) throw std::bad_alloc();
+	unlink(path.data());
+
+	if (ftruncate(fd, static_cast<off_t>(length)) != 0) {
+		close(fd);
+		throw std::bad_alloc();
+	}
+
+	// Reserve an oversized range and map the file at its first aligned address.
+	void* reserved = mmap(nullptr, length + alignment, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (reserved == MAP_FAILED) {
+		close(fd);
+		throw std::bad_alloc();
+	}
+
+	std::uintptr_t start = reinterpret_cast<std::uintptr_t>(reserved);
+	std::uintptr_t aligned = (start + alignment - 1) / alignment * alignment;
+	void* pointer = mmap(reinterpret_cast<void*>(aligned), length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+	close(fd);
+	if (pointer == MAP_FAILED) {
+		munmap(reserved, length + alignment);
+		throw std::bad_alloc();
+	}
+
+	// Release the unused head and tail of the reservation.
+	if (aligned > start) munmap(reserved, aligned - start);
+	std::uintptr_t tail = aligned + length;
+	std::uintptr_t stop = start + length + alignment;
+	if (stop > tail) munmap(reinterpret_cast<void*>(tail), stop - tail);
+
+#ifdef MADV_HUGEPAGE
+	madvise(pointer, length, MADV_HUGEPAGE);
+#endif
+	advise(pointer, length, _access);
+	return pointer;
+}
+
+inline void MappedResource::do_deallocate(void* pointer, std::size_t bytes, std::size_t align) {
+	std::size_t length = (bytes + alignment - 1) / alignment * alignment;
+	if (length == 0) length = alignment;
+	munmap(pointer, length);
+}
+
+#endif
+
+template <typename Integer>
+void adviseAccess(const Surface<Integer>& surface, MappedAccess access) {
+#ifdef SURFACE_MAPPED
+	if (!dynamic_cast<MappedResource*>(surface.grid().get_allocator().resource())) return;
+	MappedResource::advise(surface.grid().data(), surface.grid().size() * sizeof(Integer), access);
+#endif
+}
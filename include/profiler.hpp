@@ -0,0 +1,213 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <ostream>
+#include <cstdint>
+#include <type_traits>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Hot-path instrumentation. Compiled in only with -DSURFACE_PROFILE; otherwise every
+// SURFACE_PROFILE_* macro expands to nothing.
+//
+// Each thread accumulates into its own counters, merged into the global totals when the
+// thread exits, so the hot path never takes a lock.
+
+enum class ProfilePhase : unsigned {Deposition, Measurement, LockWait, Fit, Json, Count};
+
+struct ProfileCounters {
+	static constexpr unsigned phases = static_cast<unsigned>(ProfilePhase::Count);
+	static constexpr unsigned buckets = 40;
+
+	std::array<std::uint64_t, phases> ticks = {};
+	std::array<std::uint64_t, phases> calls = {};
+	std::uint64_t depositions = 0;
+
+	// Lock waits, bucketed by floor(log2(ticks)).
+	std::array<std::uint64_t, buckets> lockWait = {};
+
+	void merge(const ProfileCounters& other);
+};
+
+class Profiler {
+	std::mutex _mutex;
+	ProfileCounters _total;
+	unsigned _threads;
+
+	// Calibration of the tick counter
+	std::uint64_t _startTicks;
+	std::chrono::steady_clock::time_point _startTime;
+
+	Profiler() : _threads(0), _startTicks(ticks()), _startTime(std::chrono::steady_clock::now()) {}
+
+	// Counters of the calling thread, merged back at thread exit.
+	struct Local {
+		ProfileCounters counters;
+		~Local() {Profiler::instance().merge(counters);}
+	};
+
+public:
+	static Profiler& instance();
+	static ProfileCounters& local() {
+		thread_local Local counters;
+		return counters.counters;
+	}
+
+	// Time stamp counter when available, nanoseconds otherwise.
+	static inline std::uint64_t ticks();
+	static const char* name(ProfilePhase phase);
+	static const char* name(unsigned phase) {return name(static_cast<ProfilePhase>(phase));}
+
+	// Seconds per tick, calibrated over the lifetime of the profiler.
+	double tickSeconds() const;
+
+	// Merge the counters of a finished thread.
+	void merge(const ProfileCounters& counters);
+
+	// Totals of the finished threads plus the calling thread.
+	ProfileCounters summary();
+	unsigned threads() const {return _threads;}
+
+	// Human readable report.
+	void report(std::ostream& stream);
+};
+
+// Times a scope into a phase of the calling thread.
+class ProfileScope {
+	ProfilePhase _phase;
+	std::uint64_t _begin;
+
+public:
+	explicit ProfileScope(ProfilePhase phase) : _phase(phase), _begin(Profiler::ticks()) {}
+	~ProfileScope() {
+		ProfileCounters& counters = Profiler::local();
+		unsigned i = static_cast<unsigned>(_phase);
+		counters.ticks[i] += Profiler::ticks() - _begin;
+		counters.calls[i] += 1;
+	}
+};
+
+// Locks a mutex, recording the time spent waiting for it.
+template <typename Mutex>
+class ProfileLock {
+	Mutex& _mutex;
+
+public:
+	explicit ProfileLock(Mutex& mutex) : _mutex(mutex) {
+		std::uint64_t begin = Profiler::ticks();
+		_mutex.lock();
+		std::uint64_t wait = Profiler::ticks() - begin;
+
+		ProfileCounters& counters = Profiler::local();
+		unsigned i = static_cast<unsigned>(ProfilePhase::LockWait);
+		counters.ticks[i] += wait;
+		counters.calls[i] += 1;
+
+		unsigned bucket = 0;
+		while (wait > 1 && bucket + 1 < ProfileCounters::buckets) {
+			wait >>= 1;
+			++bucket;
+		}
+		counters.lockWait[bucket] += 1;
+	}
+
+	~ProfileLock() {_mutex.unlock();}
+};
+
+
+// Lock guards are named after the line and typed after the argument, so the macros
+// work for any mutex variable and may appear more than once in a scope.
+#define SURFACE_PROFILE_CONCAT_(a, b) a##b
+#define SURFACE_PROFILE_CONCAT(a, b) SURFACE_PROFILE_CONCAT_(a, b)
+#define SURFACE_PROFILE_LOCK_TYPE(lockable) typename std::remove_reference<decltype(lockable)>::type
+
+#ifdef SURFACE_PROFILE
+#define SURFACE_PROFILE_SCOPE(phase) ProfileScope SURFACE_PROFILE_CONCAT(profile_scope_, __LINE__)(ProfilePhase::phase)
+#define SURFACE_PROFILE_DEPOSITIONS(n) (Profiler::local().depositions += (n))
+#define SURFACE_PROFILE_LOCK(lockable) ProfileLock<SURFACE_PROFILE_LOCK_TYPE(lockable)> SURFACE_PROFILE_CONCAT(profile_lock_, __LINE__)(lockable)
+#define SURFACE_PROFILE_REPORT(stream) Profiler::instance().report(stream)
+#else
+#define SURFACE_PROFILE_SCOPE(phase)
+#define SURFACE_PROFILE_DEPOSITIONS(n)
+#define SURFACE_PROFILE_LOCK(lockable) std::lock_guard<SURFACE_PROFILE_LOCK_TYPE(lockable)> SURFACE_PROFILE_CONCAT(profile_lock_, __LINE__)(lockable)
+#define SURFACE_PROFILE_REPORT(stream)
+#endif
+
+
+inline void ProfileCounters::merge(const ProfileCounters& other) {
+	for (unsigned i = 0; i < phases; ++i) {
+		ticks[i] += other.ticks[i];
+		calls[i] += other.calls[i];
+	}
+	for (unsigned i = 0; i < buckets; ++i) lockWait[i] += other.lockWait[i];
+	depositions += other.depositions;
+}
+
+inline Profiler& Profiler::instance() {
+	static Profiler profiler;
+	return profiler;
+}
+
+inline std::uint64_t Profiler::ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+inline const char* Profiler::name(ProfilePhase phase) {
+	switch (phase) {
+		case ProfilePhase::Deposition: return "deposition";
+		case ProfilePhase::Measurement: return "measurement";
+		case ProfilePhase::LockWait: return "lock-wait";
+		case ProfilePhase::Fit: return "fit";
+		case ProfilePhase::Json: return "json";
+		default: break;
+	}
+
+	throw "Invalid phase at Profiler::name(ProfilePhase)";
+}
+
+inline double Profiler::tickSeconds() const {
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - _startTime).count();
+	std::uint64_t elapsed = ticks() - _startTicks;
+	return elapsed ? seconds / static_cast<double>(elapsed) : 0;
+}
+
+inline void Profiler::merge(const ProfileCounters& counters) {
+	std::lock_guard<std::mutex> guard(_mutex);
+	_total.merge(counters);
+	++_threads;
+}
+
+inline ProfileCounters Profiler::summary() {
+	std::lock_guard<std::mutex> guard(_mutex);
+	ProfileCounters result = _total;
+	result.merge(local());
+	return result;
+}
+
+inline void Profiler::report(std::ostream& stream) {
+	ProfileCounters total = summary();
+	double seconds = tickSeconds();
+
+	stream << "Profile (" << _threads + 1 << " threads):" << std::endl;
+	for (unsigned i = 0; i < ProfileCounters::phases; ++i) {
+		stream << "  " << name(i) << ": " << total.ticks[i] * seconds << " s in "
+			<< total.calls[i] << " calls" << std::endl;
+	}
+
+	double deposition = total.ticks[static_cast<unsigned>(ProfilePhase::Deposition)] * seconds;
+	stream << "  depositions: " << total.depositions;
+	if (deposition > 0) stream << " (" << total.depositions / deposition << " per second)";
+	stream << std::endl;
+
+	stream << "  lock-wait histogram (ticks: count):" << std::endl;
+	for (unsigned i = 0; i < ProfileCounters::buckets; ++i) {
+		if (total.lockWait[i]) stream << "    < 2^" << i+1 << ": " << total.lockWait[i] << std::endl;
+	}
+}
@@ -0,0 +1,229 @@
+#pragma once
+#include "growth.hpp"
+#include "statdata.hpp"
+#include <vector>
+#include <utility>
+#include <thread>
+#include <random>
+#include <algorithm>
+#include <functional>
+#include <cmath>
+
+// Jackknife and bootstrap errors of the growth exponents, i.e. of the slopes of
+// log <y> against log(nl) over many fit windows, where <y> is the ensemble average of the
+// data at every time. This is the fit of the ensemble-averaged curve; the "log_regression"
+// averages of the ensemble are instead the mean of the per-system slopes.
+//
+// The logarithm of an average does not follow from per-system sums, so every system keeps
+// its time series y(t). A resample averages its systems once per time; prefix sums of
+// log <y> and log(nl) log <y> then fit every window in O(1).
+// Windows are [from, to) in time indices and must not include nl = 0.
+template <typename FloatingPoint>
+class ExponentResampling {
+public:
+	typedef std::pair<unsigned, unsigned> Window;
+
+	// Result for a window
+	struct Exponent {
+		SurfaceData<FloatingPoint> inclination;
+		SurfaceData<FloatingPoint> jackknife;
+		SurfaceData<FloatingPoint> bootstrap;
+	};
+
+private:
+	std::vector<Window> _windows;
+
+	// log(nl) of the longest system.
+	std::vector<FloatingPoint> _x;
+
+	// Time series of every system, system s in [_offset[s], _offset[s+1]).
+	std::vector<SurfaceData<FloatingPoint>> _y;
+	std::vector<std::size_t> _offset;
+
+	// Add the time series of system s, with the given weight, to the sums and counts per time.
+	void accumulate(unsigned s, FloatingPoint weight, std::vector<SurfaceData<FloatingPoint>>& sum,
+		std::vector<FloatingPoint>& count) const;
+
+	// Slope of log <y> for every window, from the sums and counts per time. Windows not
+	// covered by any system are flagged in valid.
+	void slopes(const std::vector<SurfaceData<FloatingPoint>>& sum, const std::vector<FloatingPoint>& count,
+		std::vector<SurfaceData<FloatingPoint>>& result, std::vector<char>& valid) const;
+
+public:
+	// Constructor functions
+	ExponentResampling() : _offset(1, 0) {}
+	explicit ExponentResampling(const std::vector<Window>& windows) : _windows(windows), _offset(1, 0) {}
+
+	// Windows of the given length, every stride time indices, within [from, to).
+	static std::vector<Window> slidingWindows(unsigned from, unsigned to, unsigned length, unsigned stride);
+
+	// Accessor functions
+	inline bool empty() const {return _windows.empty();}
+	inline unsigned systems() const {return _offset.size() - 1;}
+	inline const std::vector<Window>& windows() const {return _windows;}
+
+	// Add the time series of a grown system.
+	template <typename Integer>
+	void newData(const SurfaceGrowth<Integer, FloatingPoint>& growth);
+
+	// Add every system of another engine with the same windows.
+	void newData(const ExponentResampling& other);
+	void clear();
+
+	// Fit, jackknife and bootstrap errors for every window. The leave-one-out and bootstrap
+	// resamples are spread over threads; the result does not depend on their number.
+	std::vector<Exponent> compute(unsigned resamples, unsigned threads, unsigned seed = 0) const;
+};
+
+
+template <typename FloatingPoint>
+std::vector<typename ExponentResampling<FloatingPoint>::Window> ExponentResampling<FloatingPoint>::slidingWindows(
+unsigned from, unsigned to, unsigned length, unsigned stride) {
+	std::vector<Window> result;
+	if (stride == 0) stride = 1;
+	for (unsigned begin = from; begin + length <= to; begin += stride) result.push_back(Window(begin, begin + length));
+	return result;
+}
+
+template <typename FloatingPoint>
+template <typename Integer>
+void ExponentResampling<FloatingPoint>::newData(const SurfaceGrowth<Integer, FloatingPoint>& growth) {
+	unsigned size = growth.dataSize();
+	for (unsigned i = 0; i < size; ++i) _y.push_back(growth.dataValue(i));
+	_offset.push_back(_y.size());
+
+	// Times shared by every system: keep the longest
+	for (unsigned i = _x.size(); i < size; ++i) _x.push_back(std::log(growth.nlValue(i)));
+}
+
+template <typename FloatingPoint>
+void ExponentResampling<FloatingPoint>::newData(const ExponentResampling& other) {
+	if (_windows != other._windows) throw "Mismatching windows at ExponentResampling::newData(const ExponentResampling&)";
+	if (_x.size() < other._x.size()) _x = other._x;
+
+	std::size_t base = _y.size();
+	_y.insert(_y.end(), other._y.begin(), other._y.end());
+	for (unsigned s = 1; s < other._offset.size(); ++s) _offset.push_back(base + other._offset[s]);
+}
+
+template <typename FloatingPoint>
+void ExponentResampling<FloatingPoint>::clear() {
+	_y.clear();
+	_offset.assign(1, 0);
+}
+
+template <typename FloatingPoint>
+void ExponentResampling<FloatingPoint>::accumulate(unsigned s, FloatingPoint weight,
+std::vector<SurfaceData<FloatingPoint>>& sum, std::vector<FloatingPoint>& count) const {
+	std::size_t begin = _offset[s], size = _offset[s+1] - begin;
+	for (std::size_t t = 0; t < size; ++t) {
+		sum[t] += _y[begin + t] * weight;
+		count[t] += weight;
+	}
+}
+
+template <typename FloatingPoint>
+void ExponentResampling<FloatingPoint>::slopes(const std::vector<SurfaceData<FloatingPoint>>& sum,
+const std::vector<FloatingPoint>& count, std::vector<SurfaceData<FloatingPoint>>& result, std::vector<char>& valid) const {
+	typedef FloatingPoint(*type)(FloatingPoint);
+	std::function<FloatingPoint(FloatingPoint)> log = static_cast<type>(std::log);
+
+	// Prefix sums of n, x, x^2, log <y> and x log <y>. The point at nl = 0 can not be
+	// fitted and would spoil the sums after it.
+	unsigned size = _x.size();
+	std::vector<FloatingPoint> pn(size + 1), px(size + 1), pxx(size + 1);
+	std::vector<SurfaceData<FloatingPoint>> py(size + 1), pxy(size + 1);
+	for (unsigned t = 0; t < size; ++t) {
+		FloatingPoint x = _x[t];
+		bool fitted = std::isfinite(x) && count[t] > 0;
+		SurfaceData<FloatingPoint> y = fitted ? (sum[t] / count[t]).runFunction(log) : SurfaceData<FloatingPoint>();
+		pn[t+1] = pn[t] + (fitted ? 1 : 0);
+		px[t+1] = px[t] + (fitted ? x : 0);
+		pxx[t+1] = pxx[t] + (fitted ? x * x : 0);
+		py[t+1] = py[t] + y;
+		pxy[t+1] = pxy[t] + y * (fitted ? x : 0);
+	}
+
+	// Least squares slope of every window
+	for (unsigned w = 0; w < _windows.size(); ++w) {
+		unsigned from = _windows[w].first, to = _windows[w].second;
+		valid[w] = to <= size && from < to && count[to-1] > 0;
+		if (!valid[w]) continue;
+
+		FloatingPoint n = pn[to] - pn[from], x = px[to] - px[from], xx = pxx[to] - pxx[from];
+		SurfaceData<FloatingPoint> y = py[to] - py[from], xy = pxy[to] - pxy[from];
+		result[w] = (xy * n - y * x) / (n * xx - x * x);
+	}
+}
+
+template <typename FloatingPoint>
+std::vector<typename ExponentResampling<FloatingPoint>::Exponent> ExponentResampling<FloatingPoint>::compute(
+unsigned resamples, unsigned threads, unsigned seed) const {
+	unsigned windows = _windows.size(), size = _x.size(), m = systems();
+	std::vector<Exponent> result(windows);
+	if (m == 0) return result;
+
+	// Full ensemble
+	std::vector<SurfaceData<FloatingPoint>> total(size), slope(windows);
+	std::vector<FloatingPoint> count(size);
+	std::vector<char> valid(windows);
+	for (unsigned s = 0; s < m; ++s) accumulate(s, 1, total, count);
+	slopes(total, count, slope, valid);
+	for (unsigned w = 0; w < windows; ++w) if (valid[w]) result[w].inclination = slope[w];
+	if (m < 2) return result;
+
+	// Tasks: m leave-one-out jackknife samples, then the bootstrap resamples of m systems
+	// drawn with replacement, each with its own generator.
+	if (resamples < 2) resamples = 0;
+	unsigned tasks = m + resamples;
+	threads = std::max(1u, std::min(threads, tasks));
+	typedef StatisticalData<SurfaceData<FloatingPoint>, FloatingPoint> Statistics;
+	std::vector<std::vector<Statistics>> jackknife(threads, std::vector<Statistics>(windows));
+	std::vector<std::vector<Statistics>> bootstrap(threads, std::vector<Statistics>(windows));
+
+	std::vector<std::thread> thread_vector;
+	for (unsigned th = 0; th < threads; ++th) {
+		thread_vector.emplace_back([&, th]() {
+			std::vector<SurfaceData<FloatingPoint>> sum(size), local(windows);
+			std::vector<FloatingPoint> number(size);
+			std::vector<char> covered(windows);
+
+			for (unsigned task = th; task < tasks; task += threads) {
+				bool leave = task < m;
+				if (leave) {
+					sum = total;
+					number = count;
+					accumulate(task, -1, sum, number);
+				} else {
+					std::fill(sum.begin(), sum.end(), SurfaceData<FloatingPoint>());
+					std::fill(number.begin(), number.end(), FloatingPoint());
+					std::mt19937 gen(seed + task - m);
+					std::uniform_int_distribution<unsigned> dist(0, m - 1);
+					for (unsigned i = 0; i < m; ++i) accumulate(dist(gen), 1, sum, number);
+				}
+
+				slopes(sum, number, local, covered);
+				std::vector<Statistics>& target = leave ? jackknife[th] : bootstrap[th];
+				for (unsigned w = 0; w < windows; ++w) if (covered[w]) target[w].newData(local[w]);
+			}
+		});
+	}
+	for (std::thread& th : thread_vector) th.join();
+
+	// Merge the threads. Jackknife: (k-1)/k sum of squares, k samples. Bootstrap: sample deviation.
+	typedef FloatingPoint(*type)(FloatingPoint);
+	std::function<FloatingPoint(FloatingPoint)> sqrt = static_cast<type>(std::sqrt);
+	for (unsigned w = 0; w < windows; ++w) {
+		Statistics jk, bs;
+		for (unsigned th = 0; th < threads; ++th) {
+			jk.newData(jackknife[th][w]);
+			bs.newData(bootstrap[th][w]);
+		}
+
+		FloatingPoint k = static_cast<FloatingPoint>(jk.size()), b = static_cast<FloatingPoint>(bs.size());
+		if (k > 1) result[w].jackknife = (jk.variance() * (k - 1)).runFunction(sqrt);
+		if (b > 1) result[w].bootstrap = (bs.variance() * (b / (b - 1))).runFunction(sqrt);
+	}
+
+	return result;
+}
@@ -0,0 +1,132 @@
+#pragma once
+#include <vector>
+#include <cmath>
+
+// Online saturation detector for the width of a growing surface.
+// The local growth exponent d log(w) / d log(nl) is fitted over the samples with nl in
+// [fraction * nl, nl]. A single fit of a single system is too noisy to trust, so the surface
+// is only considered saturated once the exponent stays below the tolerance for a number of
+// consecutive samples. The growth is then stopped after a fixed number of extra samples.
+// Samples from stationary() on stand for the saturated regime: the extra samples, grown
+// after the detection and so free of its selection, or the flat run if there are none.
+// Prefix sums make every sample O(1).
+template <typename FloatingPoint>
+class SaturationDetector {
+	// Parameters
+	FloatingPoint _tolerance;
+	FloatingPoint _fraction;
+	unsigned _extra;
+	unsigned _minimum;
+	unsigned _consecutive;
+
+	// Prefix sums of x = log(nl), y = log(w): n, x, y, x^2, x*y
+	std::vector<double> _nl;
+	std::vector<double> _sx, _sy, _sxx, _sxy;
+	unsigned _begin;
+
+	// First sample of the current run of flat fits, or -1.
+	long _flat;
+
+	// Sample at which saturation was detected, or -1.
+	long _detected;
+	FloatingPoint _slope;
+
+public:
+	// Constructor functions
+	SaturationDetector() : _tolerance(), _fraction(), _extra(0), _minimum(0), _consecutive(0), _begin(0),
+	_flat(-1), _detected(-1), _slope() {}
+	SaturationDetector(const FloatingPoint& tolerance, unsigned extra,
+		const FloatingPoint& fraction = FloatingPoint(0.5), unsigned minimum = 10, unsigned consecutive = 10)
+	: _tolerance(tolerance), _fraction(fraction), _extra(extra), _minimum(minimum), _consecutive(consecutive),
+	_begin(0), _flat(-1), _detected(-1), _slope() {}
+
+	// Accessor functions
+	inline bool enabled() const {return _tolerance > 0;}
+	inline bool saturated() const {return _detected >= 0;}
+	inline long detected() const {return _detected;}
+	inline unsigned stationary() const {return _extra > 0 ? _detected + 1 : _flat;}
+	inline FloatingPoint slope() const {return _slope;}
+
+	// Register a sample. Returns true when the growth should stop.
+	bool newData(const FloatingPoint& nl, const FloatingPoint& width);
+
+	// Room for the given number of samples.
+	void reserve(unsigned samples);
+	void clear();
+};
+
+
+template <typename FloatingPoint>
+bool SaturationDetector<FloatingPoint>::newData(const FloatingPoint& nl, const FloatingPoint& width) {
+	// Points that can not be put in log scale do not count.
+	double x = std::log(static_cast<double>(nl));
+	double y = std::log(static_cast<double>(width));
+	if (!std::isfinite(x) || !std::isfinite(y)) {
+		x = 0;
+		y = 0;
+	}
+
+	if (_sx.empty()) {
+		_sx.push_back(0);
+		_sy.push_back(0);
+		_sxx.push_back(0);
+		_sxy.push_back(0);
+	}
+
+	unsigned last = _nl.size();
+	_nl.push_back(nl);
+	_sx.push_back(_sx[last] + x);
+	_sy.push_back(_sy[last] + y);
+	_sxx.push_back(_sxx[last] + x * x);
+	_sxy.push_back(_sxy[last] + x * y);
+
+	// Past the detection: only count the extra samples.
+	if (_detected >= 0) return static_cast<long>(_nl.size()) - 1 - _detected >= static_cast<long>(_extra);
+
+	// Window [fraction * nl, nl]
+	double from = _fraction * static_cast<double>(nl);
+	while (_begin < last && (_nl[_begin] < from || !(_nl[_begin] > 0))) ++_begin;
+	unsigned end = last + 1;
+	double n = end - _begin;
+	if (n < _minimum) return false;
+
+	double sx = _sx[end] - _sx[_begin], sy = _sy[end] - _sy[_begin];
+	double sxx = _sxx[end] - _sxx[_begin], sxy = _sxy[end] - _sxy[_begin];
+	double den = n * sxx - sx * sx;
+	if (!(den > 0)) return false;
+
+	_slope = static_cast<FloatingPoint>((n * sxy - sx * sy) / den);
+	if (!(std::abs(_slope) < _tolerance)) {
+		_flat = -1;
+		return false;
+	}
+
+	// Flat: wait for enough flat fits in a row.
+	if (_flat < 0) _flat = last;
+	if (static_cast<long>(last) - _flat + 1 < static_cast<long>(_consecutive)) return false;
+
+	_detected = last;
+	return _extra == 0;
+}
+
+template <typename FloatingPoint>
+void SaturationDetector<FloatingPoint>::reserve(unsigned samples) {
+	_nl.reserve(samples);
+	_sx.reserve(samples + 1);
+	_sy.reserve(samples + 1);
+	_sxx.reserve(samples + 1);
+	_sxy.reserve(samples + 1);
+}
+
+template <typename FloatingPoint>
+void SaturationDetector<FloatingPoint>::clear() {
+	_nl.clear();
+	_sx.clear();
+	_sy.clear();
+	_sxx.clear();
+	_sxy.clear();
+	_begin = 0;
+	_flat = -1;
+	_detected = -1;
+	_slope = FloatingPoint();
+}
@@ -0,0 +1,311 @@
+#pragma once
+#include "growth.hpp"
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <string>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+// Binary profile container:
+//     header: "SURFPRF1"
+//     record: u32 id, f64 nl, u32 sx, u32 sy, u64 bytes, payload
+// The payload holds sx*sy heights as zigzag varints of the difference to the previous site.
+// Fixed-size fields are written in native byte order.
+struct ProfileSnapshot {
+	unsigned id;
+	double nl;
+	unsigned sx, sy;
+	std::vector<long long> heights;
+};
+
+
+// Asynchronous profile writer. The raw offsets of a snapshot are copied into one of a
+// bounded pool of buffers and encoded and written by a background thread, so the caller
+// only pays for the copy. The caller never waits for the disk: buffers are added as needed
+// up to the bound, and beyond it snapshots are dropped and counted in dropped().
+// Write errors are reported by the next snapshot() and by close().
+class ProfileWriter {
+	// Snapshot waiting to be written: the grid as copied, in its own integer type.
+	struct Buffer {
+		unsigned id;
+		double nl;
+		unsigned sx, sy;
+		long long base;
+		std::size_t size;
+		std::vector<unsigned char> offsets;
+		long long (*offset)(const unsigned char* offsets, std::size_t i);
+	};
+
+	// Read the i-th offset of the given integer type.
+	template <typename Integer>
+	static long long offsetOf(const unsigned char* offsets, std::size_t i);
+
+	// Output
+	std::ofstream _file;
+	std::vector<double> _schedule;
+
+	// Buffer pool: free buffers and buffers waiting to be written. A deque keeps the
+	// buffers in place when it grows.
+	std::deque<Buffer> _buffers;
+	std::vector<Buffer*> _free;
+	std::deque<Buffer*> _queue;
+	unsigned _limit;
+	std::atomic<unsigned long long> _dropped;
+
+	// Synchronization
+	std::mutex _mutex;
+	std::condition_variable _condition;
+	bool _closing;
+	std::atomic<bool> _failed;
+	std::thread _thread;
+
+	// Background loop
+	void run();
+	void write(const Buffer& snapshot, std::vector<unsigned char>& bytes);
+
+public:
+	// Constructor functions. At most the given number of snapshots wait in memory.
+	explicit ProfileWriter(const std::string& str, unsigned buffers = 2);
+	~ProfileWriter() {try {close();} catch (...) {}}
+
+	ProfileWriter(const ProfileWriter&) = delete;
+	ProfileWriter& operator=(const ProfileWriter&) = delete;
+
+	// Values of nl at which measure() takes a snapshot.
+	inline void schedule(const std::vector<double>& nl) {
+		_schedule = nl;
+		std::sort(_schedule.begin(), _schedule.end());
+	}
+
+	// Take a snapshot now.
+	template <typename Integer>
+	void snapshot(const Surface<Integer>& surface, double nl, unsigned id = 0);
+
+	// Take a snapshot if a scheduled nl was crossed by the last iteration of the growth.
+	// Does not keep state, so a single writer can serve several systems and threads.
+	template <typename Integer, typename FloatingPoint>
+	void measure(const SurfaceGrowth<Integer, FloatingPoint>& growth, unsigned id = 0);
+
+	// Take the snapshots scheduled over the samples a growth replayed after stopping at
+	// saturation, from its last grown profile.
+	template <typename Integer, typename FloatingPoint>
+	void replay(const SurfaceGrowth<Integer, FloatingPoint>& growth, unsigned id = 0);
+
+	// Accessor functions
+	inline bool failed() const {return _failed.load(std::memory_order_relaxed);}
+	inline unsigned long long dropped() const {return _dropped.load(std::memory_order_relaxed);}
+
+	// Allow one spare buffer per producer thread, so that none of them drops while the
+	// writer keeps up.
+	void producers(unsigned count);
+
+	// Write all pending snapshots and stop the background thread. Throws on a write error.
+	void close();
+};
+
+
+// Reads the snapshots written by ProfileWriter, one at a time.
+class ProfileReader {
+	std::ifstream _file;
+
+public:
+	explicit ProfileReader(const std::string& str);
+
+	// Read the next snapshot. Returns false at the end of the file.
+	bool next(ProfileSnapshot& snapshot);
+};
+
+
+inline ProfileWriter::ProfileWriter(const std::string& str, unsigned buffers)
+: _file(str, std::ios::binary), _limit(std::max(buffers, 1u)), _dropped(0), _closing(false), _failed(false) {
+	if (!_file) throw "Could not open file at ProfileWriter::ProfileWriter(const std::string&, unsigned)";
+	_file.write("SURFPRF1", 8);
+	_thread = std::thread(&ProfileWriter::run, this);
+}
+
+inline void ProfileWriter::producers(unsigned count) {
+	std::lock_guard<std::mutex> guard(_mutex);
+	_limit = std::max(_limit, count + 1);
+}
+
+template <typename Integer>
+long long ProfileWriter::offsetOf(const unsigned char* offsets, std::size_t i) {
+	Integer value;
+	std::memcpy(&value, offsets + i * sizeof(Integer), sizeof(Integer));
+	return static_cast<long long>(value);
+}
+
+template <typename Integer>
+void ProfileWriter::snapshot(const Surface<Integer>& surface, double nl, unsigned id) {
+	if (failed()) throw "Write error at ProfileWriter::snapshot(const Surface&, double, unsigned)";
+
+	// Take a free buffer, add one if all of them are queued, or drop the snapshot
+	std::unique_lock<std::mutex> lock(_mutex);
+	if (_free.empty()) {
+		if (_buffers.size() >= _limit) {
+			_dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		_buffers.emplace_back();
+		_free.push_back(&_buffers.back());
+	}
+	Buffer* buffer = _free.back();
+	_free.pop_back();
+	lock.unlock();
+
+	// Copy the offsets as they are; heights are rebuilt by the writer
+	std::size_t size = surface.size();
+	buffer->id = id;
+	buffer->nl = nl;
+	buffer->sx = surface.sizex();
+	buffer->sy = surface.sizey();
+	buffer->base = surface.base();
+	buffer->size = size;
+	buffer->offsets.resize(size * sizeof(Integer));
+	std::memcpy(buffer->offsets.data(), surface.grid().data(), size * sizeof(Integer));
+	buffer->offset = &ProfileWriter::offsetOf<Integer>;
+
+	// Hand it to the writer
+	lock.lock();
+	_queue.push_back(buffer);
+	lock.unlock();
+	_condition.notify_all();
+}
+
+template <typename Integer, typename FloatingPoint>
+void ProfileWriter::measure(const SurfaceGrowth<Integer, FloatingPoint>& growth, unsigned id) {
+	unsigned last = growth.nlSize() - 1;
+	double nl = static_cast<double>(growth.nlValue(last));
+
+	// First scheduled value after the previous iteration
+	auto it = _schedule.begin();
+	if (last > 0) it = std::upper_bound(_schedule.begin(), _schedule.end(), static_cast<double>(growth.nlValue(last-1)));
+	if (it != _schedule.end() && *it <= nl) snapshot(growth, nl, id);
+}
+
+template <typename Integer, typename FloatingPoint>
+void ProfileWriter::replay(const SurfaceGrowth<Integer, FloatingPoint>& growth, unsigned id) {
+	for (unsigned t = std::max(growth.grownSize(), 1u); t < growth.nlSize(); ++t) {
+		double previous = static_cast<double>(growth.nlValue(t-1)), nl = static_cast<double>(growth.nlValue(t));
+		auto it = std::upper_bound(_schedule.begin(), _schedule.end(), previous);
+		if (it != _schedule.end() && *it <= nl) snapshot(growth, nl, id);
+	}
+}
+
+inline void ProfileWriter::run() {
+	std::vector<unsigned char> bytes;
+
+	while (true) {
+		std::unique_lock<std::mutex> lock(_mutex);
+		_condition.wait(lock, [this]() {return _closing || !_queue.empty();});
+		if (_queue.empty()) return;
+
+		Buffer* buffer = _queue.front();
+		_queue.pop_front();
+		lock.unlock();
+
+		// After an error the remaining snapshots are dropped.
+		if (!failed()) write(*buffer, bytes);
+
+		lock.lock();
+		_free.push_back(buffer);
+		lock.unlock();
+		_condition.notify_all();
+	}
+}
+
+inline void ProfileWriter::write(const Buffer& snapshot, std::vector<unsigned char>& bytes) {
+	// Delta and zigzag varint encoding
+	bytes.clear();
+	long long previous = 0;
+	for (std::size_t i = 0; i < snapshot.size; ++i) {
+		long long height = snapshot.base + snapshot.offset(snapshot.offsets.data(), i);
+		long long delta = height - previous;
+		unsigned long long value = (static_cast<unsigned long long>(delta) << 1) ^ static_cast<unsigned long long>(delta >> 63);
+		while (value >= 0x80) {
+			bytes.push_back(static_cast<unsigned char>(value | 0x80));
+			value >>= 7;
+		}
+		bytes.push_back(static_cast<unsigned char>(value));
+		previous = height;
+	}
+
+	// Record
+	std::uint32_t id = snapshot.id, sx = snapshot.sx, sy = snapshot.sy;
+	std::uint64_t length = bytes.size();
+	_file.write(reinterpret_cast<const char*>(&id), sizeof(id));
+	_file.write(reinterpret_cast<const char*>(&snapshot.nl), sizeof(snapshot.nl));
+	_file.write(reinterpret_cast<const char*>(&sx), sizeof(sx));
+	_file.write(reinterpret_cast<const char*>(&sy), sizeof(sy));
+	_file.write(reinterpret_cast<const char*>(&length), sizeof(length));
+	_file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+	if (!_file) _failed.store(true, std::memory_order_relaxed);
+}
+
+inline void ProfileWriter::close() {
+	if (!_thread.joinable()) return;
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	_closing = true;
+	lock.unlock();
+	_condition.notify_all();
+
+	_thread.join();
+	if (!failed()) _file.flush();
+	if (!_file) _failed.store(true, std::memory_order_relaxed);
+	_file.close();
+	if (failed()) throw "Write error at ProfileWriter::close()";
+}
+
+
+inline ProfileReader::ProfileReader(const std::string& str) : _file(str, std::ios::binary) {
+	char magic[8];
+	_file.read(magic, 8);
+	if (!_file || std::memcmp(magic, "SURFPRF1", 8) != 0) throw "Invalid file at ProfileReader::ProfileReader(const std::string&)";
+}
+
+inline bool ProfileReader::next(ProfileSnapshot& snapshot) {
+	std::uint32_t id, sx, sy;
+	std::uint64_t length;
+	_file.read(reinterpret_cast<char*>(&id), sizeof(id));
+	if (!_file) return false;
+	_file.read(reinterpret_cast<char*>(&snapshot.nl), sizeof(snapshot.nl));
+	_file.read(reinterpret_cast<char*>(&sx), sizeof(sx));
+	_file.read(reinterpret_cast<char*>(&sy), sizeof(sy));
+	_file.read(reinterpret_cast<char*>(&length), sizeof(length));
+
+	std::vector<unsigned char> bytes(length);
+	_file.read(reinterpret_cast<char*>(bytes.data()), length);
+	if (!_file) throw "Truncated file at ProfileReader::next(ProfileSnapshot&)";
+
+	// Decode the heights
+	snapshot.id = id;
+	snapshot.sx = sx;
+	snapshot.sy = sy;
+	snapshot.heights.resize(static_cast<std::size_t>(sx) * sy);
+
+	std::size_t pos = 0;
+	long long previous = 0;
+	for (long long& height : snapshot.heights) {
+		unsigned long long value = 0;
+		unsigned shift = 0;
+		while (pos < length) {
+			unsigned char byte = bytes[pos++];
+			value |= static_cast<unsigned long long>(byte & 0x7f) << shift;
+			shift += 7;
+			if (!(byte & 0x80)) break;
+		}
+
+		long long delta = static_cast<long long>(value >> 1) ^ -static_cast<long long>(value & 1);
+		height = previous + delta;
+		previous = height;
+	}
+
+	return true;
+}
@@ -1,37 +1,50 @@
 #pragma once
 #include <array>
+#include <vector>
+#include <string>
 
+// Running statistics up to the given order. Keeps the mean and the sums of powers of the
+// deviations from the mean, M_p = sum (x - mean)^p, updated with the Welford/Pebay
+// formulas. Unlike raw power sums these do not suffer cancellation, and two
+// accumulators merge exactly for any order (P. Pebay, SAND2008-6212).
 template <typename DataStructure, typename FloatingPoint, unsigned order=2>
 class StatisticalData {
+	// _moments[0] is the mean, _moments[p-1] is M_p for p >= 2.
 	std::array<DataStructure, order> _moments;
 	unsigned _size;
-	
+
+	// Binomial coefficient.
+	static FloatingPoint binomial(unsigned n, unsigned k);
+
 public:
 	// Constructor
 	StatisticalData() : _moments(), _size(0) {}
-	
+
 	StatisticalData(const StatisticalData& data)
 	: _moments(data._moments), _size(data._size) {}
-	
+
 	template <typename Type>
 	StatisticalData(const std::vector<Type>& data);
-	
+
+	StatisticalData& operator=(const StatisticalData& data) = default;
+
 	// Accessor Functions
 	inline unsigned size() const {return _size;}
-	inline FloatingPoint moment(unsigned i) const {return _moments[i-1];}
+	DataStructure moment(unsigned i) const;
+	DataStructure centralMoment(unsigned i) const;
 
 	// Modification functions
 	void newData(const DataStructure& data);
 	void newData(const StatisticalData& data);
 	void clear();
-	
+
 	// Direct from data source
 	template <typename Type>
 	void overrideData(const std::vector<Type>& array);
-	
+
 	template <typename Type>
 	void newData(const std::vector<Type>& array);
-	
+
 	// Accessing more data
 	DataStructure average() const;
 	DataStructure variance() const;
@@ -40,56 +53,124 @@ public:
 	DataStructure operator[](const std::string& str) const;
 };
 
+template <typename DataStructure, typename FloatingPoint, unsigned order>
+FloatingPoint StatisticalData<DataStructure, FloatingPoint, order>::binomial(unsigned n, unsigned k) {
+	FloatingPoint result = 1;
+	for (unsigned i = 1; i <= k; ++i) result = result * static_cast<FloatingPoint>(n - k + i) / static_cast<FloatingPoint>(i);
+	return result;
+}
+
 template <typename DataStructure, typename FloatingPoint, unsigned order>
 template <typename Type>
-StatisticalData<DataStructure, FloatingPoint, order>::StatisticalData(const std::vector<Type>& data) {
+StatisticalData<DataStructure, FloatingPoint, order>::StatisticalData(const std::vector<Type>& data) : _moments(), _size(0) {
 	this->overrideData(data);
 }
 
+// Raw moment <x^i>, rebuilt from the mean and the central moments.
 template <typename DataStructure, typename FloatingPoint, unsigned order>
-void StatisticalData<DataStructure, FloatingPoint, order>::newData(const DataStructure& data) {
-	FloatingPoint size = static_cast<FloatingPoint>(_size);
-	FloatingPoint newsize = static_cast<FloatingPoint>(_size+1);
-	
-	DataStructure dd = data;
-	_moments[0] = size / newsize  * _moments[0] + dd / newsize;
-	for (unsigned i = 1; i < order; ++i) {
-		dd *= data;
-		_moments[i] = size / newsize  * _moments[i] + dd / newsize;
+DataStructure StatisticalData<DataStructure, FloatingPoint, order>::moment(unsigned i) const {
+	const DataStructure& mean = _moments[0];
+	DataStructure result = mean;
+	for (unsigned n = 1; n < i; ++n) result *= mean;
+
+	for (unsigned k = 2; k <= i; ++k) {
+		DataStructure term = centralMoment(k) * binomial(i, k);
+		for (unsigned n = k; n < i; ++n) term *= mean;
+		result += term;
 	}
-	
+
+	return result;
+}
+
+// Central moment <(x - <x>)^i>.
+template <typename DataStructure, typename FloatingPoint, unsigned order>
+DataStructure StatisticalData<DataStructure, FloatingPoint, order>::centralMoment(unsigned i) const {
+	if (i < 2 || _size == 0) return DataStructure();
+	return _moments[i-1] / static_cast<FloatingPoint>(_size);
+}
+
+template <typename DataStructure, typename FloatingPoint, unsigned order>
+void StatisticalData<DataStructure, FloatingPoint, order>::newData(const DataStructure& data) {
 	++_size;
+	if (_size == 1) {
+		_moments = std::array<DataStructure, order>();
+		_moments[0] = data;
+		return;
+	}
+
+	FloatingPoint n = static_cast<FloatingPoint>(_size);
+	FloatingPoint na = n - 1;
+	DataStructure delta = data - _moments[0];
+
+	// Higher orders first, since they depend on the old lower ones.
+	for (unsigned p = order; p >= 2; --p) {
+		// Correction terms from the lower sums: C(p,k) (-delta/n)^k M_{p-k}.
+		DataStructure power = delta * (-1 / n);
+		for (unsigned k = 1; k + 2 <= p; ++k) {
+			_moments[p-1] += binomial(p, k) * (power * _moments[p-k-1]);
+			power *= delta * (-1 / n);
+		}
+
+		// The new point itself: (na delta / n)^p (1 - (-1/na)^(p-1)).
+		DataStructure last = delta * (na / n);
+		FloatingPoint sign = -1 / na;
+		FloatingPoint factor = sign;
+		for (unsigned k = 1; k < p; ++k) last *= delta * (na / n);
+		for (unsigned k = 2; k < p; ++k) factor *= sign;
+		_moments[p-1] += last * (1 - factor);
+	}
+
+	_moments[0] += delta / n;
 }
 
 template <typename DataStructure, typename FloatingPoint, unsigned order>
 void StatisticalData<DataStructure, FloatingPoint, order>::newData(const StatisticalData& data) {
-	FloatingPoint size1 = static_cast<FloatingPoint>(_size);
-	FloatingPoint size2 = static_cast<FloatingPoint>(data._size);
-	FloatingPoint newsize = static_cast<FloatingPoint>(_size+data._size);
-	
-	for (unsigned i = 0; i < order; ++i) {
-		_moments[i] = size1 / newsize * _moments[i] + size2 / newsize * data._moments[i];
+	if (data._size == 0) return;
+	if (_size == 0) {
+		*this = data;
+		return;
 	}
-	
+
+	FloatingPoint na = static_cast<FloatingPoint>(_size);
+	FloatingPoint nb = static_cast<FloatingPoint>(data._size);
+	FloatingPoint n = na + nb;
+	DataStructure delta = data._moments[0] - _moments[0];
+
+	// Higher orders first, since they depend on the old lower ones.
+	for (unsigned p = order; p >= 2; --p) {
+		_moments[p-1] += data._moments[p-1];
+
+		// Correction terms from the lower sums:
+		// C(p,k) delta^k [(-nb/n)^k Ma_{p-k} + (na/n)^k Mb_{p-k}].
+		DataStructure power = delta;
+		FloatingPoint fa = -nb / n, fb = na / n;
+		for (unsigned k = 1; k + 2 <= p; ++k) {
+			_moments[p-1] += binomial(p, k) * (power * (_moments[p-k-1] * fa + data._moments[p-k-1] * fb));
+			power *= delta;
+			fa *= -nb / n;
+			fb *= na / n;
+		}
+
+		// Term of the means: (na nb delta / n)^p (1/nb^(p-1) - (-1/na)^(p-1)).
+		DataStructure last = delta * (na * nb / n);
+		FloatingPoint ib = 1 / nb, ia = -1 / na;
+		for (unsigned k = 1; k < p; ++k) last *= delta * (na * nb / n);
+		for (unsigned k = 2; k < p; ++k) {
+			ib /= nb;
+			ia *= -1 / na;
+		}
+		_moments[p-1] += last * (ib - ia);
+	}
+
+	_moments[0] += delta * (nb / n);
 	_size += data._size;
 }
 
 template <typename DataStructure, typename FloatingPoint, unsigned order>
 template <typename Type>
 void StatisticalData<DataStructure, FloatingPoint, order>::overrideData(const std::vector<Type>& array) {
-	FloatingPoint size = static_cast<FloatingPoint>(array.size());
-	for (const Type& data : array) {
-		DataStructure converted_data = static_cast<DataStructure>(data);
-		
-		DataStructure dd = converted_data;
-		_moments[0] += dd / size;
-		for (int i = 1; i < order; ++i) {
-			dd *= converted_data;
-			_moments[i] += dd / size;
-		}
-	}
-	
-	_size = array.size();
+	this->clear();
+	for (const Type& data : array) this->newData(static_cast<DataStructure>(data));
 }
 
 template <typename DataStructure, typename FloatingPoint, unsigned order>
@@ -114,7 +195,7 @@ DataStructure StatisticalData<DataStructure, FloatingPoint, order>::average() co
 
 template <typename DataStructure, typename FloatingPoint, unsigned order>
 DataStructure StatisticalData<DataStructure, FloatingPoint, order>::variance() const {
-	return _moments[1] - _moments[0] * _moments[0];
+	return centralMoment(2);
 }
 
 template <typename DataStructure, typename FloatingPoint, unsigned order>
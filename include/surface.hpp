@@ -1,47 +1,111 @@
 #pragma once
 #include <vector>
+#include <memory_resource>
 #include <fstream>
+#include <limits>
+#include <algorithm>
+#include <climits>
 #include "surfacedata.hpp"
 
 // TODO: Later: To create a SurfaceHD Class.
 
+// Heights are stored as offsets from a tracked base, so that narrow integer types
+// (e.g. Surface<std::int16_t>) can be used: height = base() + surface[i].
+// Deposition kernels work on the offsets. Writes through operator[], operator() or put()
+// keep the largest offset; kernels must raise it by at most one per deposition, so that
+// reserveHeadroom() knows how many depositions fit and rebases only when needed.
+// The grid is allocated from a memory resource (see mapped.hpp for out-of-core storage).
 template <typename Integer>
 class Surface {
-	std::vector<Integer> _grid;
+	std::pmr::vector<Integer> _grid;
 	
 	// Sizes. 2D and 3D Mode.
 	unsigned _size;
 	unsigned _sx, _sy;
+
+	// Base height, largest offset, and largest offset right after the last rebase.
+	long long _base;
+	long long _top;
+	long long _rebased;
+
+	// Largest offset the type can hold, as a long long.
+	static long long limit();
 	
 public:
+	// Writable offset of a site, as returned by the non-const accessors. It behaves like
+	// Integer& for the usual kernel idioms (=, ++, --, +=, -=, reading) and keeps the
+	// largest offset of the surface up to date.
+	class Reference {
+		Integer& _value;
+		long long& _top;
+
+		inline Reference& raised() {
+			if (static_cast<long long>(_value) > _top) _top = static_cast<long long>(_value);
+			return *this;
+		}
+
+	public:
+		Reference(Integer& value, long long& top) : _value(value), _top(top) {}
+
+		inline operator Integer() const {return _value;}
+		inline Reference& operator=(Integer value) {_value = value; return raised();}
+		inline Reference& operator=(const Reference& other) {return *this = static_cast<Integer>(other);}
+		inline Reference& operator+=(Integer value) {_value += value; return raised();}
+		inline Reference& operator-=(Integer value) {_value -= value; return *this;}
+		inline Reference& operator++() {++_value; return raised();}
+		inline Reference& operator--() {--_value; return *this;}
+		inline Integer operator++(int) {Integer old = _value; ++*this; return old;}
+		inline Integer operator--(int) {Integer old = _value; --_value; return old;}
+	};
+
 	// Constructor functions
-	explicit Surface(unsigned size) : _size(size), _grid(size) {}
+	explicit Surface(unsigned size, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+	: _size(size), _sx(size), _sy(1), _grid(size, resource), _base(0), _top(0), _rebased(0) {}
 	
-	explicit Surface(const Surface& surface)
-	: _grid(surface._grid), _size(surface._size), _sx(surface._sx), _sy(surface._sy) {}
+	explicit Surface(const Surface& surface, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+	: _grid(surface._grid, resource), _size(surface._size), _sx(surface._sx), _sy(surface._sy),
+	_base(surface._base), _top(surface._top), _rebased(surface._rebased) {}
 
-	Surface(unsigned sx, unsigned sy)
-	: _sx(sx), _sy(sy)  {_size = _sx * _sy; _grid.resize(_size);}
+	Surface(unsigned sx, unsigned sy, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+	: _sx(sx), _sy(sy), _grid(resource), _base(0), _top(0), _rebased(0) {_size = _sx * _sy; _grid.resize(_size);}
 	
 	
-	// Accessor functions
-	inline const std::vector<Integer>& grid() const {return _grid;}
+	// Accessor functions. The grid is a std::pmr::vector (it was a std::vector before the
+	// memory resources); it holds offsets from base(), not heights.
+	inline const std::pmr::vector<Integer>& grid() const {return _grid;}
 	inline unsigned size() const {return _size;}
 	inline unsigned sizex() const {return _sx;}
 	inline unsigned sizey() const {return _sy;}
+	inline long long base() const {return _base;}
+	inline long long height(unsigned num) const {return _base + static_cast<long long>(_grid[num]);}
 	
 	
-	// Accessing the surface
+	// Accessing the surface (offsets from the base)
 	inline const Integer& operator[](unsigned num) const {return _grid[num];}
-	inline Integer& operator[](unsigned num) {return _grid[num];}
+	inline Reference operator[](unsigned num) {return Reference(_grid[num], _top);}
 	
 	inline const Integer& operator()(unsigned x, unsigned y) const {return _grid[_sx * y + x];}
-	inline Integer& operator()(unsigned x, unsigned y) {return _grid[_sx * y + x];}
+	inline Reference operator()(unsigned x, unsigned y) {return Reference(_grid[_sx * y + x], _top);}
+
+	// Write an offset, keeping the largest one.
+	inline void put(unsigned num, Integer offset) {(*this)[num] = offset;}
 	
 
 	// Modifying the surface
 	inline void clear() { _grid.clear(); }
-	inline void clear(const Surface<Integer>& surface) {_grid = surface._grid;}
+	inline void clear(const Surface<Integer>& surface) {
+		_grid = surface._grid;
+		_base = surface._base;
+		_top = surface._top;
+		_rebased = surface._rebased;
+	}
+
+	// Move the lowest offset to zero, adding it to the base.
+	void rebase();
+
+	// Reserve room for up to the given number of depositions, rebasing if needed.
+	// Returns how many depositions can be performed safely.
+	unsigned reserveHeadroom(unsigned depositions);
 
 	// Surface calculation data: nth moment
 	template <typename FloatingPoint>
@@ -59,14 +123,52 @@ public:
 };
 
 
+template <typename Integer>
+void Surface<Integer>::rebase() {
+	if (_grid.empty()) return;
+
+	Integer low = _grid[0], high = _grid[0];
+	for (unsigned i = 1; i < _size; ++i) {
+		if (_grid[i] < low) low = _grid[i];
+		if (_grid[i] > high) high = _grid[i];
+	}
+
+	for (unsigned i = 0; i < _size; ++i) _grid[i] -= low;
+	_base += static_cast<long long>(low);
+	_top = static_cast<long long>(high) - static_cast<long long>(low);
+	_rebased = _top;
+}
+
+template <typename Integer>
+long long Surface<Integer>::limit() {
+	// Unsigned 64 bit types do not fit in a long long.
+	if (static_cast<unsigned long long>(std::numeric_limits<Integer>::max()) > static_cast<unsigned long long>(LLONG_MAX)) return LLONG_MAX;
+	return static_cast<long long>(std::numeric_limits<Integer>::max());
+}
+
+template <typename Integer>
+unsigned Surface<Integer>::reserveHeadroom(unsigned depositions) {
+	const long long room = limit();
+
+	// Rebase once the top has taken half of the room left by the last rebase, so the
+	// O(size) scan runs about once per (limit - spread) / 2 layers, not once per chunk.
+	if (_top - _rebased > (room - _rebased) / 2) rebase();
+	
+	long long granted = std::min<long long>(depositions, room - _top);
+	if (granted <= 0) throw "Height spread too large for the integer type at Surface::reserveHeadroom(unsigned)";
+
+	return static_cast<unsigned>(granted);
+}
+
 template <typename Integer>
 template <typename FloatingPoint>
 FloatingPoint Surface<Integer>::nthMomentHeight(unsigned order) const {
 	FloatingPoint result = FloatingPoint();
 
+	FloatingPoint base = static_cast<FloatingPoint>(_base);
 	for (unsigned i = 0; i < _size; ++i) {
 		FloatingPoint size = static_cast<FloatingPoint>(_size);
-		FloatingPoint height = static_cast<FloatingPoint>(_grid[i]);
+		FloatingPoint height = base + static_cast<FloatingPoint>(_grid[i]);
 		FloatingPoint power = 1;
 		
 		for (unsigned n = 0; n < order; ++n) {
@@ -87,8 +189,8 @@ FloatingPoint Surface<Integer>::nthCentralMomentHeight(unsigned order) const {
 	if (order == 0) return 1;
 	if (order == 1) return 0;
 
-	// Calculate the first moment (average around zero)
-	FloatingPoint av = nthMomentHeight<FloatingPoint>(1);
+	// Calculate the first moment (average around zero), relative to the base
+	FloatingPoint av = nthMomentHeight<FloatingPoint>(1) - static_cast<FloatingPoint>(_base);
 
 	// Compute the nthCentralMoment as requested
 	FloatingPoint result = FloatingPoint();
@@ -116,9 +218,10 @@ SurfaceData<FloatingPoint> Surface<Integer>::surfaceData() const {
 	std::array<FloatingPoint, 4> central = {0, 0, 0, 0};
 
 	// Calculate the moments around zero.
+	FloatingPoint base = static_cast<FloatingPoint>(_base);
 	for (unsigned i = 0; i < _size; ++i) {
 		FloatingPoint size = static_cast<FloatingPoint>(_size);
-		FloatingPoint height = static_cast<FloatingPoint>(_grid[i]);
+		FloatingPoint height = base + static_cast<FloatingPoint>(_grid[i]);
 		FloatingPoint power[4];
 		
 		power[0] = height;
@@ -126,8 +229,8 @@ SurfaceData<FloatingPoint> Surface<Integer>::surfaceData() const {
 		for (unsigned n = 0; n < 4; ++n) moment[n] += power[n] / size; 
 	}
 
-	// Calculate the central moments
-	FloatingPoint av = moment[0];
+	// Calculate the central moments, relative to the base
+	FloatingPoint av = moment[0] - base;
 	for (unsigned i = 0; i < _size; ++i) {
 		FloatingPoint size = static_cast<FloatingPoint>(_size);
 		FloatingPoint height = static_cast<FloatingPoint>(_grid[i]);
@@ -147,8 +250,8 @@ void Surface<Integer>::saveProfile(const std::string& str) const {
 	std::ofstream file(str);
 	file << "profile = [";
 
-	file << _grid[0];
-	for (int i = 1; i < _size; ++i) file << ", " << _grid[i];
+	file << height(0);
+	for (int i = 1; i < _size; ++i) file << ", " << height(i);
 
 	file << "];";
 	file.close();
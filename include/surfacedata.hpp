@@ -23,7 +23,7 @@ public:
 	static constexpr unsigned mom = 8;		// Moments.
 	
 	// Constructur functions
-	SurfaceData() : _moments(), _width(), _skewness(), _kurtosis() {}
+	SurfaceData() : _moments(), _centralMoments(), _width(), _skewness(), _kurtosis() {}
 	
 	SurfaceData(const std::array<FloatingPoint, 4>& moments, 
 	const std::array<FloatingPoint, 4>& central)
@@ -2,6 +2,7 @@
 #include <deposition.hpp>
 #include <string>
 #include <fstream>
+#include <iostream>
 
 int main() {
 	SurfaceGrowthEnsemble<int, float, 10> surface(10);
@@ -13,4 +14,7 @@ int main() {
 	std::ofstream file("simulation.json");
 	file << json << std::flush;
 	file.close();
+
+	// Only with -DSURFACE_PROFILE
+	SURFACE_PROFILE_REPORT(std::cerr);
 }